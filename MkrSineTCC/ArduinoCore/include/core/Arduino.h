@@ -60,6 +60,7 @@ int main( void );
 void init( void );
 
 /* sketch */
+void setupEarly( void ) ;
 void setup( void ) ;
 void loop( void ) ;
 
@@ -76,9 +77,15 @@ void loop( void ) ;
   #include "Tone.h"
   #include "WMath.h"
   #include "HardwareSerial.h"
+  #include "PrintFormat.h"
   #include "pulse.h"
 #endif
 #include "delay.h"
+#include "boot.h"
+#include "metrics.h"
+#include "trace.h"
+#include "dma.h"
+#include "timebase.h"
 #ifdef __cplusplus
   #include "Uart.h"
 #endif
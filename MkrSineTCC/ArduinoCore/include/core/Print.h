@@ -61,6 +61,13 @@ class Print
     // should be overriden by subclasses with buffering
     virtual int availableForWrite() { return 0; }
 
+    // Zero-copy output: lends the free contiguous space of the transmit buffer
+    // and returns its size, 0 if there is none or the class does not buffer.
+    // Every reserve() must be followed by commit() with the number of bytes
+    // written into it, even 0.
+    virtual size_t reserve(uint8_t **data) { return 0; }
+    virtual void commit(size_t length) { }
+
     size_t print(const __FlashStringHelper *);
     size_t print(const String &);
     size_t print(const char[]);
@@ -73,6 +80,11 @@ class Print
     size_t print(double, int = 2);
     size_t print(const Printable&);
 
+    // Q-format fixed-point value with fractionalBits (0..31) bits after the
+    // binary point, printed with digits (0..9) rounded decimals without any
+    // floating point arithmetic, e.g. printFixed(0x18000, 16, 2) prints "1.50"
+    size_t printFixed(long value, uint8_t fractionalBits, uint8_t digits = 2);
+
     size_t println(const __FlashStringHelper *);
     size_t println(const String &s);
     size_t println(const char[]);
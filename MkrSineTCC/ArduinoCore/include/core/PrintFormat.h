@@ -0,0 +1,151 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PrintFormat_h
+#define PrintFormat_h
+
+#include "Print.h"
+#include "format.h"
+
+/*
+ * Formatted output without heap, String or per-fragment writes:
+ *
+ *   PRINT_FORMAT(Serial, "n={} top={x} duty={.1}%\n", n, top, duty);
+ *
+ * The line is rendered in one pass straight into the transmit buffer lent by
+ * Print::reserve(), or through a small stack buffer for classes which do not
+ * lend one. Placeholders are "{}" or "{spec}" with spec made of an optional
+ * width ("8", "08" pads numbers with zeros), a base ("x" hex, "o" octal, "b"
+ * binary) and ".N" decimals for floating point (default 2, at most 9). Every
+ * argument is right-aligned to the width, text always with spaces. "{{" and
+ * "}}" print single braces.
+ *
+ * PRINT_FORMAT checks at compile time that the number of placeholders matches
+ * the number of arguments (format must be a string literal of up to ~500
+ * characters), and argument types without a formatArgument() overload do not
+ * compile. printFormat() is the same without the placeholder count check.
+ */
+
+struct FormatSpec {
+  uint8_t base;
+  uint8_t width;
+  uint8_t digits;
+  bool zeroPad;
+};
+
+// Q-format fixed-point argument, see formatFixed()
+struct FormatFixed {
+  FormatFixed(long value, uint8_t fractionalBits, uint8_t digits = 2) :
+    value(value), fractionalBits(fractionalBits), digits(digits) {}
+  long value;
+  uint8_t fractionalBits;
+  uint8_t digits;
+};
+
+class FormatWriter {
+  public:
+    FormatWriter(Print &out) : out(out), start(0), span(0), spanEnd(0), reserved(false), total(0) {}
+
+    void write(const char *data, size_t size);
+    void writeNumber(unsigned long magnitude, bool negative, const FormatSpec &spec);
+    void writePadded(const char *str, size_t length, const FormatSpec &spec, bool number);
+
+    // Writes literal text up to the next placeholder and parses its spec,
+    // returns the text following it or NULL at the end of the format.
+    const char *writeUntilPlaceholder(const char *format, FormatSpec *spec);
+
+    // Hands the rendered text over and returns the number of bytes sent.
+    size_t finish();
+
+  private:
+    void nextSpan();
+
+    Print &out;
+    uint8_t *start, *span, *spanEnd;
+    bool reserved;
+    size_t total;
+    uint8_t local[32];
+};
+
+void formatArgument(FormatWriter &w, const FormatSpec &spec, char c);
+void formatArgument(FormatWriter &w, const FormatSpec &spec, const char *s);
+void formatArgument(FormatWriter &w, const FormatSpec &spec, bool b);
+void formatArgument(FormatWriter &w, const FormatSpec &spec, long n);
+void formatArgument(FormatWriter &w, const FormatSpec &spec, unsigned long n);
+void formatArgument(FormatWriter &w, const FormatSpec &spec, double n);
+void formatArgument(FormatWriter &w, const FormatSpec &spec, const void *p);
+void formatArgument(FormatWriter &w, const FormatSpec &spec, const FormatFixed &f);
+
+inline void formatArgument(FormatWriter &w, const FormatSpec &spec, signed char n) { formatArgument(w, spec, (long)n); }
+inline void formatArgument(FormatWriter &w, const FormatSpec &spec, unsigned char n) { formatArgument(w, spec, (unsigned long)n); }
+inline void formatArgument(FormatWriter &w, const FormatSpec &spec, short n) { formatArgument(w, spec, (long)n); }
+inline void formatArgument(FormatWriter &w, const FormatSpec &spec, unsigned short n) { formatArgument(w, spec, (unsigned long)n); }
+inline void formatArgument(FormatWriter &w, const FormatSpec &spec, int n) { formatArgument(w, spec, (long)n); }
+inline void formatArgument(FormatWriter &w, const FormatSpec &spec, unsigned int n) { formatArgument(w, spec, (unsigned long)n); }
+inline void formatArgument(FormatWriter &w, const FormatSpec &spec, float n) { formatArgument(w, spec, (double)n); }
+
+inline void formatNext(FormatWriter &w, const char *format)
+{
+  FormatSpec spec;
+  while (format != NULL) {
+    format = w.writeUntilPlaceholder(format, &spec); // placeholders without arguments stay empty
+  }
+}
+
+template<typename T, typename... Rest>
+void formatNext(FormatWriter &w, const char *format, const T &arg, const Rest&... rest)
+{
+  FormatSpec spec;
+  format = w.writeUntilPlaceholder(format, &spec);
+  if (format == NULL) return; // more arguments than placeholders
+  formatArgument(w, spec, arg);
+  formatNext(w, format, rest...);
+}
+
+template<typename... Args>
+size_t printFormat(Print &out, const char *format, const Args&... args)
+{
+  FormatWriter w(out);
+  formatNext(w, format, args...);
+  return w.finish();
+}
+
+// number of placeholders in a format, recursive for C++11 constexpr
+constexpr int countFormatPlaceholders(const char *f, bool inside = false)
+{
+  return *f == 0 ? 0 :
+    inside ? (*f == '}' ? 1 + countFormatPlaceholders(f + 1, false) : countFormatPlaceholders(f + 1, true)) :
+    *f != '{' ? countFormatPlaceholders(f + 1, false) :
+    f[1] == '{' ? countFormatPlaceholders(f + 2, false) : countFormatPlaceholders(f + 1, true);
+}
+
+template<bool placeholdersMatchArguments, typename... Args>
+size_t printFormatChecked(Print &out, const char *format, const Args&... args)
+{
+  static_assert(placeholdersMatchArguments, "number of {} placeholders does not match the number of arguments");
+  return printFormat(out, format, args...);
+}
+
+#define PRINT_FORMAT_NUM_ARGS(...) PRINT_FORMAT_NUM_ARGS_(0, ##__VA_ARGS__, \
+  16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define PRINT_FORMAT_NUM_ARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, \
+  _11, _12, _13, _14, _15, _16, N, ...) N
+
+#define PRINT_FORMAT(out, format, ...) \
+  printFormatChecked<countFormatPlaceholders(format) == PRINT_FORMAT_NUM_ARGS(__VA_ARGS__)>( \
+    out, format, ##__VA_ARGS__)
+
+#endif
@@ -22,22 +22,33 @@
 #define _RING_BUFFER_
 
 #include <stdint.h>
+#include <string.h>
 
 // Define constants and variables for buffering incoming serial data.  We're
-// using a ring buffer (I think), in which head is the index of the location
-// to which to write the next incoming character and tail is the index of the
-// location from which to read.
+// using a ring buffer, in which head counts the characters ever written and
+// tail the characters ever read; both run freely and are masked with N-1 to
+// index the buffer, so N must be a power of two and all N bytes are usable.
+//
+// Single producer, single consumer: one context (e.g. an interrupt handler)
+// only stores and the other one only reads, then no locking is needed. Each
+// side writes only its own index and publishes it after the data, a compiler
+// barrier keeps that order (on the single-core M0+ no hardware barrier is needed).
+// clear() must not race with either side.
 #ifndef SERIAL_BUFFER_SIZE
 #define SERIAL_BUFFER_SIZE 256
 #endif
 
+#define RING_BUFFER_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
 template <int N>
 class RingBufferN
 {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "RingBufferN size must be a power of two");
+
   public:
     uint8_t _aucBuffer[N] ;
-    volatile int _iHead ;
-    volatile int _iTail ;
+    volatile uint32_t _iHead ;
+    volatile uint32_t _iTail ;
 
   public:
     RingBufferN( void ) ;
@@ -49,8 +60,17 @@ class RingBufferN
     int peek();
     bool isFull();
 
-  private:
-    int nextIndex(int index);
+    // bulk copies, return the number of bytes copied
+    int write( const uint8_t *data, int size ) ;
+    int read( uint8_t *data, int size ) ;
+
+    // producer side zero-copy: contiguous free space, then publish n bytes of it
+    int reserve( uint8_t **data ) ;
+    void commit( int n ) ;
+
+    // consumer side zero-copy: contiguous stored data, then consume n bytes of it
+    int borrow( const uint8_t **data ) ;
+    void release( int n ) ;
 };
 
 typedef RingBufferN<SERIAL_BUFFER_SIZE> RingBuffer;
@@ -66,16 +86,14 @@ RingBufferN<N>::RingBufferN( void )
 template <int N>
 void RingBufferN<N>::store_char( uint8_t c )
 {
-  int i = nextIndex(_iHead);
+  uint32_t head = _iHead;
 
-  // if we should be storing the received character into the location
-  // just before the tail (meaning that the head would advance to the
-  // current location of the tail), we're about to overflow the buffer
-  // and so we don't write the character or advance the head.
-  if ( i != _iTail )
+  // if the buffer is full we don't write the character or advance the head
+  if ( head - _iTail != N )
   {
-    _aucBuffer[_iHead] = c ;
-    _iHead = i ;
+    _aucBuffer[head & (N - 1)] = c ;
+    RING_BUFFER_BARRIER();
+    _iHead = head + 1 ;
   }
 }
 
@@ -89,11 +107,14 @@ void RingBufferN<N>::clear()
 template <int N>
 int RingBufferN<N>::read_char()
 {
-  if(_iTail == _iHead)
+  uint32_t tail = _iTail;
+  if(tail == _iHead)
     return -1;
 
-  uint8_t value = _aucBuffer[_iTail];
-  _iTail = nextIndex(_iTail);
+  RING_BUFFER_BARRIER();
+  uint8_t value = _aucBuffer[tail & (N - 1)];
+  RING_BUFFER_BARRIER();
+  _iTail = tail + 1;
 
   return value;
 }
@@ -101,42 +122,102 @@ int RingBufferN<N>::read_char()
 template <int N>
 int RingBufferN<N>::available()
 {
-  int delta = _iHead - _iTail;
-
-  if(delta < 0)
-    return N + delta;
-  else
-    return delta;
+  return _iHead - _iTail;
 }
 
 template <int N>
 int RingBufferN<N>::availableForStore()
 {
-  if (_iHead >= _iTail)
-    return N - 1 - _iHead + _iTail;
-  else
-    return _iTail - _iHead - 1;
+  return N - (_iHead - _iTail);
 }
 
 template <int N>
 int RingBufferN<N>::peek()
 {
-  if(_iTail == _iHead)
+  uint32_t tail = _iTail;
+  if(tail == _iHead)
     return -1;
 
-  return _aucBuffer[_iTail];
+  RING_BUFFER_BARRIER();
+  return _aucBuffer[tail & (N - 1)];
 }
 
 template <int N>
-int RingBufferN<N>::nextIndex(int index)
+bool RingBufferN<N>::isFull()
 {
-  return (uint32_t)(index + 1) % N;
+  return (_iHead - _iTail == N);
 }
 
 template <int N>
-bool RingBufferN<N>::isFull()
+int RingBufferN<N>::reserve( uint8_t **data )
+{
+  uint32_t head = _iHead;
+  uint32_t free = N - (head - _iTail);
+  uint32_t index = head & (N - 1);
+  uint32_t contiguous = N - index;
+
+  *data = &_aucBuffer[index];
+  return free < contiguous ? free : contiguous;
+}
+
+template <int N>
+void RingBufferN<N>::commit( int n )
+{
+  RING_BUFFER_BARRIER();
+  _iHead = _iHead + n;
+}
+
+template <int N>
+int RingBufferN<N>::borrow( const uint8_t **data )
+{
+  uint32_t tail = _iTail;
+  uint32_t stored = _iHead - tail;
+  uint32_t index = tail & (N - 1);
+  uint32_t contiguous = N - index;
+
+  RING_BUFFER_BARRIER();
+  *data = &_aucBuffer[index];
+  return stored < contiguous ? stored : contiguous;
+}
+
+template <int N>
+void RingBufferN<N>::release( int n )
 {
-  return (nextIndex(_iHead) == _iTail);
+  RING_BUFFER_BARRIER();
+  _iTail = _iTail + n;
+}
+
+template <int N>
+int RingBufferN<N>::write( const uint8_t *data, int size )
+{
+  // at most two spans, before and after the end of the buffer
+  int written = 0;
+  for (int i = 0; i < 2 && written < size; i++) {
+    uint8_t *span;
+    int n = reserve(&span);
+    if (n == 0) break;
+    if (n > size - written) n = size - written;
+    memcpy(span, data + written, n);
+    commit(n);
+    written += n;
+  }
+  return written;
+}
+
+template <int N>
+int RingBufferN<N>::read( uint8_t *data, int size )
+{
+  int count = 0;
+  for (int i = 0; i < 2 && count < size; i++) {
+    const uint8_t *span;
+    int n = borrow(&span);
+    if (n == 0) break;
+    if (n > size - count) n = size - count;
+    memcpy(data + count, span, n);
+    release(n);
+    count += n;
+  }
+  return count;
 }
 
 #endif /* _RING_BUFFER_ */
@@ -167,6 +167,11 @@ class SERCOM
 		void acknowledgeUARTError() ;
 		void enableDataRegisterEmptyInterruptUART();
 		void disableDataRegisterEmptyInterruptUART();
+		void enableReceiveInterruptUART();
+		void disableReceiveInterruptUART();
+		volatile void *dataRegisterUART() ;
+		uint8_t getDmacTriggerRx() ;
+		uint8_t getDmacTriggerTx() ;
 
 		/* ========== SPI ========== */
 		void initSPI(SercomSpiTXPad mosi, SercomRXPad miso, SercomSpiCharSize charSize, SercomDataOrder dataOrder) ;
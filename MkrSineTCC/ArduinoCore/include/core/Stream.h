@@ -60,6 +60,13 @@ class Stream : public Print
     virtual int read() = 0;
     virtual int peek() = 0;
 
+    // Zero-copy access to buffered input: lends the next contiguous block of
+    // received bytes and returns its length (0 if nothing is buffered or the
+    // stream does not support it). The block stays valid until release(),
+    // which consumes the given number of bytes of it.
+    virtual size_t borrow(const uint8_t **data) { return 0; }
+    virtual void release(size_t length) { }
+
     Stream() {_timeout=1000;}
 
 // parsing methods
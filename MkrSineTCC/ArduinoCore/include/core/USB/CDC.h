@@ -89,6 +89,10 @@ public:
 	virtual int availableForWrite(void);
 	virtual int peek(void);
 	virtual int read(void);
+	virtual size_t borrow(const uint8_t **data);
+	virtual void release(size_t length);
+	virtual size_t reserve(uint8_t **data);
+	virtual void commit(size_t length);
 	virtual void flush(void);
 	virtual void clear(void);
 	virtual size_t write(uint8_t);
@@ -96,8 +100,6 @@ public:
 	using Print::write; // pull in write(str) from Print
 	operator bool();
 
-	size_t readBytes(char *buffer, size_t length);
-
 	// This method allows processing "SEND_BREAK" requests sent by
 	// the USB host. Those requests indicate that the host wants to
 	// send a BREAK signal and are accompanied by a single uint16_t
@@ -251,8 +251,13 @@ public:
 	virtual uint32_t recv(void *_data, uint32_t len) = 0;
 	virtual uint32_t available() = 0;
 	virtual int peek() = 0;
+	virtual uint32_t borrow(const uint8_t **_data) = 0;
+	virtual void release(uint32_t len) = 0;
 };
 
+// Receives into two banks alternately: while the application reads one of them
+// the hardware fills the other one. The data is read directly from the banks,
+// either copied by recv() or lent in place by borrow()/release().
 class DoubleBufferedEPOutHandler : public EPHandler {
 public:
 	enum { size = 64 };
@@ -270,23 +275,16 @@ public:
 		usbd.epBank0SetAddress(ep, const_cast<uint8_t *>(data0));
 		usbd.epBank0EnableTransferComplete(ep);
 
-		release();
+		releaseBank();
 	}
 
 	virtual ~DoubleBufferedEPOutHandler() {
 	}
 
-	uint32_t _recv()
+	// Lends the unread part of the current bank, returns its length
+	virtual uint32_t borrow(const uint8_t **_data)
 	{
-		uint32_t i = 0;
-		uint32_t len = 0;
-
-		synchronized {
-			len = _rx_buffer.availableForStore();
-		}
-
-		// R/W: current, first0/1, ready0/1, notify
-		// R  : last0/1, data0/1
+		// R: current, first0/1, ready0/1, last0/1, data0/1
 		if (current == 0) {
 			synchronized {
 				if (!ready0) {
@@ -294,71 +292,71 @@ public:
 				}
 			}
 			// when ready0==true the buffer is not being filled and last0 is constant
-			for (; i<len && first0 < last0; i++) {
-				_rx_buffer.store_char(data0[first0++]);
+			*_data = const_cast<const uint8_t *>(&data0[first0]);
+			return last0 - first0;
+		} else {
+			synchronized {
+				if (!ready1) {
+					return 0;
+				}
 			}
-			if (first0 == last0) {
+			// when ready1==true the buffer is not being filled and last1 is constant
+			*_data = const_cast<const uint8_t *>(&data1[first1]);
+			return last1 - first1;
+		}
+	}
+
+	// Consumes len bytes of the lent bank, gives it back to hardware when empty
+	virtual void release(uint32_t len)
+	{
+		// R/W: current, first0/1, ready0/1, notify
+		// R  : last0/1
+		if (current == 0) {
+			first0 += len;
+			if (first0 >= last0) {
 				first0 = 0;
 				current = 1;
 				synchronized {
 					ready0 = false;
 					if (notify) {
 						notify = false;
-						release();
+						releaseBank();
 					}
 				}
 			}
 		} else {
-			synchronized {
-				if (!ready1) {
-					return 0;
-				}
-			}
-			// when ready1==true the buffer is not being filled and last1 is constant
-			for (; i<len && first1 < last1; i++) {
-				_rx_buffer.store_char(data1[first1++]);
-			}
-			if (first1 == last1) {
+			first1 += len;
+			if (first1 >= last1) {
 				first1 = 0;
 				current = 0;
 				synchronized {
 					ready1 = false;
 					if (notify) {
 						notify = false;
-						release();
+						releaseBank();
 					}
 				}
 			}
 		}
-		return i;
 	}
 
 	virtual uint32_t recv(void *_data, uint32_t len) {
-		_recv();
-		uint32_t i = 0;
 		uint8_t *data = reinterpret_cast<uint8_t *>(_data);
-		synchronized {
-			for (; i < len && _rx_buffer.available(); i++) {
-				data[i] = _rx_buffer.read_char();
-			}
-		}
-		return i;
-	}
-
-	virtual uint32_t _available() const {
-		if (current == 0) {
-			bool ready = ready0;
-			synchronized {
-				ready = ready0;
+		uint32_t i = 0;
+		while (i < len) {
+			const uint8_t *span;
+			uint32_t n = borrow(&span);
+			if (n == 0) {
+				break;
 			}
-			return ready ? (last0 - first0) : 0;
-		} else {
-			bool ready = false;
-			synchronized {
-				ready = ready1;
+			if (n > len - i) {
+				n = len - i;
 			}
-			return ready ? (last1 - first1) : 0;
+			memcpy(&data[i], span, n);
+			release(n);
+			i += n;
 		}
+		return i;
 	}
 
 	virtual void handleEndpoint()
@@ -369,7 +367,7 @@ public:
 		{
 			uint32_t received = usbd.epBank0ByteCount(ep);
 			if (received == 0) {
-				release();
+				releaseBank();
 			} else if (incoming == 0) {
 			// Update counters and swap banks for non-ZLP's
 				last0 = received;
@@ -379,7 +377,7 @@ public:
 					ready0 = true;
 					notify = ready1;
 					if (!notify) {
-						release();
+						releaseBank();
 					}
 				}
 			} else {
@@ -390,7 +388,7 @@ public:
 					ready1 = true;
 					notify = ready0;
 					if (!notify) {
-						release();
+						releaseBank();
 					}
 				}
 			}
@@ -398,26 +396,33 @@ public:
 		}
 	}
 
-	// Returns how many bytes are stored in the buffers
+	// Returns how many bytes are stored in the banks
 	virtual uint32_t available() {
-		_recv();
-		return _rx_buffer.available();
+		// the bank which is not current is either empty or untouched (first == 0)
+		uint32_t count = 0;
+		synchronized {
+			if (ready0) {
+				count += last0 - first0;
+			}
+			if (ready1) {
+				count += last1 - first1;
+			}
+		}
+		return count;
 	}
 
 	virtual int peek() {
-		_recv();
-		return _rx_buffer.peek();
+		const uint8_t *span;
+		return borrow(&span) ? span[0] : -1;
 	}
 
-	void release() {
+	void releaseBank() {
 		usbd.epReleaseOutBank0(ep, size);
 	}
 
 private:
 	USBDevice_SAMD21G18x &usbd;
 
-	RingBuffer _rx_buffer;
-
 	const uint32_t ep;
 	volatile uint32_t current, incoming;
 
@@ -434,3 +439,174 @@ private:
 	volatile bool notify;
 };
 
+/*
+ * USB IN EP generic handlers.
+ */
+
+class EPInHandler {
+public:
+	virtual void handleEndpoint() = 0;
+	virtual void handleStartOfFrame() = 0;
+	virtual uint32_t send(const void *_data, uint32_t len) = 0;
+	virtual uint32_t reserve(uint8_t **_data) = 0;
+	virtual void commit(uint32_t len) = 0;
+	virtual uint32_t availableForWrite() = 0;
+	virtual void flush() = 0;
+	virtual void clear() = 0;
+};
+
+// Ping-pong transmit buffer: the CPU fills one bank while the USB DMA sends
+// the other one as a multi-packet transfer (up to bankSize bytes, split into
+// 64 byte packets by the hardware). A full bank is started from send() or
+// from the Transfer Complete interrupt, a partial one on the next Start-Of-Frame
+// (at most 1ms later) or on flush(). send() never waits and returns the
+// number of bytes which fit into the filling bank, USBDeviceClass::send()
+// waits for room.
+// NOTE: single producer, send() must not be called from interrupts which may
+// preempt another send().
+class BufferedEPInHandler : public EPInHandler {
+public:
+	enum { size = 64, bankSize = 256 }; // bankSize must be a multiple of size
+
+	BufferedEPInHandler(USBDevice_SAMD21G18x &usbDev, uint32_t endPoint) :
+		usbd(usbDev),
+		ep(endPoint),
+		fill(0), fillCount(0),
+		busy(false), writing(false), pendingKick(false)
+	{
+		usbd.epBank1SetSize(ep, 64);
+		usbd.epBank1SetType(ep, 3); // BULK IN
+		usbd.epBank1SetAddress(ep, const_cast<uint8_t *>(data[0]));
+		usbd.epBank1SetMultiPacketSize(ep, 0);
+		// transfers which are a multiple of 64 bytes are ended by a ZLP
+		usbd.epBank1EnableAutoZLP(ep);
+		usbd.epBank1EnableTransferComplete(ep);
+	}
+
+	virtual ~BufferedEPInHandler() {
+	}
+
+	virtual uint32_t send(const void *_data, uint32_t len)
+	{
+		uint8_t *dst;
+		uint32_t room = reserve(&dst);
+		if (len > room)
+			len = room;
+		memcpy(dst, _data, len);
+		commit(len);
+		return len;
+	}
+
+	// Zero-copy write: lends the free rest of the filling bank. Every reserve()
+	// must be followed by commit() with the number of bytes written, even 0.
+	virtual uint32_t reserve(uint8_t **_data)
+	{
+		// While writing is set the interrupt handlers do not swap banks
+		// and leave the swap to us by setting pendingKick.
+		writing = true;
+		__DMB();
+
+		uint32_t count = fillCount;
+		*_data = const_cast<uint8_t *>(&data[fill][count]);
+		return bankSize - count;
+	}
+
+	virtual void commit(uint32_t len)
+	{
+		fillCount = fillCount + len;
+
+		__DMB();
+		writing = false;
+
+		if (pendingKick || fillCount == bankSize) {
+			kick();
+		}
+	}
+
+	virtual uint32_t availableForWrite() {
+		return bankSize - fillCount;
+	}
+
+	virtual void flush() {
+		kick();
+	}
+
+	virtual void clear() {
+		synchronized {
+			fillCount = 0;
+		}
+	}
+
+	virtual void handleEndpoint()
+	{
+		if (usbd.epBank1IsTransferComplete(ep))
+		{
+			usbd.epBank1AckTransferComplete(ep);
+			busy = false;
+
+			// keep streaming while there is at least one whole packet,
+			// a smaller rest waits for the next Start-Of-Frame
+			if (fillCount >= size) {
+				kickFromInterrupt();
+			}
+		}
+		usbd.epAckPendingInterrupts(ep);
+	}
+
+	virtual void handleStartOfFrame()
+	{
+		if (fillCount != 0) {
+			kickFromInterrupt();
+		}
+	}
+
+private:
+	void kickFromInterrupt()
+	{
+		if (writing) {
+			pendingKick = true;
+		} else {
+			kick();
+		}
+	}
+
+	// Starts sending the filling bank unless the other one is still in transfer
+	void kick()
+	{
+		synchronized {
+			pendingKick = false;
+
+			// also poll the flag, so flush() makes progress when called
+			// from a context which blocks the USB interrupt
+			if (busy && usbd.epBank1IsTransferComplete(ep)) {
+				usbd.epBank1AckTransferComplete(ep);
+				busy = false;
+			}
+
+			uint32_t count = fillCount;
+			if (busy || count == 0) {
+				return;
+			}
+
+			uint32_t bank = fill;
+			fill = bank ^ 1;
+			fillCount = 0;
+			busy = true;
+
+			usbd.epBank1SetAddress(ep, const_cast<uint8_t *>(data[bank]));
+			usbd.epBank1SetMultiPacketSize(ep, 0);
+			usbd.epBank1SetByteCount(ep, count);
+			usbd.epBank1AckTransferComplete(ep);
+			usbd.epBank1SetReady(ep);
+		}
+	}
+
+	USBDevice_SAMD21G18x &usbd;
+
+	const uint32_t ep;
+
+	volatile uint32_t fill, fillCount;
+	volatile bool busy, writing, pendingKick;
+
+	__attribute__((__aligned__(4)))	volatile uint8_t data[2][bankSize];
+};
@@ -88,10 +88,16 @@ public:
 	void initEP(uint32_t ep, uint32_t type);
 
 	uint32_t send(uint32_t ep, const void *data, uint32_t len);
+	uint32_t reserve(uint32_t ep, uint8_t **data);
+	void commit(uint32_t ep, uint32_t len);
 	void sendZlp(uint32_t ep);
 	uint32_t recv(uint32_t ep, void *data, uint32_t len);
 	int recv(uint32_t ep);
+	int peek(uint32_t ep);
+	uint32_t borrow(uint32_t ep, const uint8_t **data);
+	void release(uint32_t ep, uint32_t len);
 	uint32_t available(uint32_t ep);
+	uint32_t availableForWrite(uint32_t ep);
 	void flush(uint32_t ep);
 	void clear(uint32_t ep);
 	void stall(uint32_t ep);
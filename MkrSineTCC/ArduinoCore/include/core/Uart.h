@@ -38,10 +38,25 @@ class Uart : public HardwareSerial
     int read();
     void flush();
     size_t write(const uint8_t data);
-    using Print::write; // pull in write(str) and write(buf, size) from Print
+    size_t write(const uint8_t *buffer, size_t size);
+    using Print::write; // pull in write(str) from Print
+    size_t borrow(const uint8_t **data);
+    void release(size_t size);
 
     void IrqHandler();
 
+    // Moves received and transmitted bytes by DMA instead of one interrupt per
+    // byte (8-bit frames, no RTS), call after begin(). Reception runs in circles
+    // through the RX buffer, which must be read at least once per SERIAL_BUFFER_SIZE
+    // bytes; transmission costs one interrupt per contiguous span of the TX buffer.
+    // Returns 0 on success, 1 if no DMA channels are free.
+    int enableDma();
+    void disableDma();
+
+    // True once received data is waiting and nothing arrived for idleMicros,
+    // i.e. the end of a frame (the SERCOM has no idle line detection). Poll it.
+    bool receiveIdle(uint32_t idleMicros);
+
     operator bool() { return true; }
 
   private:
@@ -59,6 +74,22 @@ class Uart : public HardwareSerial
     uint32_t ul_pinMaskRTS;
     uint8_t uc_pinCTS;
 
+    void updateRTS();
+    void waitForTxSpace();
+    void startTransmit();
+    void startTxDma();
+    void pollRxDma();
+    void updateRxDmaHead();
+    static void rxDmaCallback(void *uart, uint8_t flags);
+    static void txDmaCallback(void *uart, uint8_t flags);
+
+    int8_t rxDmaChannel;
+    int8_t txDmaChannel;
+    volatile uint16_t txDmaCount; // bytes in flight, 0 when idle
+    volatile uint32_t rxDmaLaps; // completed laps of the receive channel
+    uint32_t rxIdleHead;
+    uint32_t rxIdleStamp;
+
     SercomNumberStopBit extractNbStopBit(uint16_t config);
     SercomUartCharSize extractCharSize(uint16_t config);
     SercomParityMode extractParity(uint16_t config);
@@ -0,0 +1,76 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _BOOT_
+#define _BOOT_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Boot phases executed by main() before the first call to loop(), in order.
+ * Each phase is timed with micros() from the moment the timebase is started;
+ * the time spent in Reset_Handler (clock setup) is not included.
+ */
+typedef enum
+{
+  BOOT_PHASE_TIMEBASE = 0,  // TC4/TC5 timebase started
+  BOOT_PHASE_CONSTRUCTORS,  // C++ global constructors
+  BOOT_PHASE_SETUP_EARLY,   // sketch setupEarly() hook
+  BOOT_PHASE_INIT,          // pins, ADC and DAC initialization and initVariant()
+  BOOT_PHASE_USB_ATTACH,    // USB device init and attach
+  BOOT_PHASE_SETUP,         // sketch setup()
+  BOOT_PHASE_USB_OPEN,      // host opened the serial port, marked by the sketch
+  BOOT_PHASE_COUNT
+} BootPhase ;
+
+/**
+ * \brief Records the end of a boot phase, only the first call for each phase counts.
+ */
+extern void bootPhaseEnd( BootPhase phase ) ;
+
+/**
+ * \brief Returns the time in microseconds from timebase start to the end of a phase.
+ *
+ * \return 0 if the phase was not recorded
+ */
+extern uint32_t bootPhaseEndMicros( BootPhase phase ) ;
+
+/**
+ * \brief Returns the duration of a phase from the end of the previous recorded phase.
+ *
+ * \return 0 if the phase was not recorded
+ */
+extern uint32_t bootPhaseDurationMicros( BootPhase phase ) ;
+
+/**
+ * \brief Returns true if the end of the phase was recorded.
+ */
+extern int bootPhaseIsRecorded( BootPhase phase ) ;
+
+/**
+ * \brief Returns a short name of the phase for reports.
+ */
+extern const char *bootPhaseName( BootPhase phase ) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BOOT_ */
@@ -44,6 +44,7 @@ extern unsigned long millis( void ) ;
  * of eight microseconds.
  *
  * \note There are 1,000 microseconds in a millisecond and 1,000,000 microseconds in a second.
+ * \note timebaseMicros() returns the same count in 64 bits, see timebase.h.
  */
 extern unsigned long micros( void ) ;
 
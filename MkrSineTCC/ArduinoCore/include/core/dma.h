@@ -0,0 +1,93 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef _DMA_
+#define _DMA_
+
+#include <stdint.h>
+#include "sam.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Minimal DMAC driver: channel allocation, one descriptor per channel and
+ * per-channel completion callbacks dispatched from DMAC_Handler().
+ *
+ * A channel is set up by filling its descriptor (dmaDescriptor(), dmaSetupBlock())
+ * and trigger (dmaConfigure()), then started with dmaStart(). Descriptors may link
+ * to themselves through DESCADDR for circular transfers. The callback runs in the
+ * DMAC interrupt at DMA_NVIC_PRIORITY with the DMAC_CHINTFLAG_* bits that were set.
+ */
+#define DMA_NVIC_PRIORITY ((1<<__NVIC_PRIO_BITS) - 2)
+
+typedef void (*DmaCallback)( void *context, uint8_t flags ) ;
+
+/**
+ * \brief Returns a free channel or -1 if all are in use, enables the DMAC on first use.
+ */
+extern int dmaAllocate( void ) ;
+
+/**
+ * \brief Stops a channel and returns it to the pool.
+ */
+extern void dmaFree( int channel ) ;
+
+extern DmacDescriptor *dmaDescriptor( int channel ) ;
+
+/**
+ * \brief Fills a descriptor for one block of beats, addresses are the first beat ones.
+ *
+ * btctrl holds the DMAC_BTCTRL_* bits, VALID is added. Incrementing addresses are
+ * converted to the end addresses the DMAC expects (STEPSIZE X1 only).
+ */
+extern void dmaSetupBlock( DmacDescriptor *descriptor, const volatile void *source, volatile void *destination, uint16_t beats, uint16_t btctrl ) ;
+
+/**
+ * \brief Selects the peripheral trigger (DMAC_ID_* or 0 for software) and DMAC_CHCTRLB_TRIGACT_*.
+ */
+extern void dmaConfigure( int channel, uint8_t trigger, uint32_t triggerAction ) ;
+
+/**
+ * \brief Sets the callback and the DMAC_CHINTENSET_* interrupts which invoke it.
+ */
+extern void dmaSetCallback( int channel, DmaCallback callback, void *context, uint8_t interrupts ) ;
+
+extern void dmaStart( int channel ) ;
+
+/**
+ * \brief Disables a channel and waits until an ongoing beat has finished.
+ */
+extern void dmaStop( int channel ) ;
+
+extern int dmaIsBusy( int channel ) ;
+
+/**
+ * \brief Returns the beats left in the current block of a started channel.
+ */
+extern uint16_t dmaRemaining( int channel ) ;
+
+/**
+ * \brief Dispatches pending channel interrupts, for callers which cannot be
+ * preempted by DMAC_Handler() and wait for a transfer.
+ */
+extern void dmaService( void ) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DMA_ */
@@ -0,0 +1,54 @@
+/*
+  Copyright (c) 2015 Arduino LLC.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Number formatting without divisions, the Cortex-M0+ has no hardware divider
+ * and every "/" or "%" is a library call. Base 10 is formatted two digits at a
+ * time through a multiply by the reciprocal of 100 and a digit pair table,
+ * powers of two by shifts. All functions write backwards, ending right before
+ * "end", and return a pointer to the first character; nothing is terminated.
+ */
+#define FORMAT_BUFFER_SIZE 34 // enough for any of the functions below
+
+extern char* formatDecimal( uint32_t value, char *end ) ;
+extern char* formatBase( uint32_t value, uint8_t base, char *end ) ;
+
+// Exactly "digits" decimal digits with leading zeros, value must be below 10^digits.
+extern char* formatFraction( uint32_t value, uint8_t digits, char *end ) ;
+
+// Signed fixed-point value with "fractionalBits" bits after the binary point
+// (Q-format, 0..31) as decimal with "digits" rounded fraction digits (0..9).
+extern char* formatFixed( int32_t value, uint8_t fractionalBits, uint8_t digits, char *end ) ;
+
+// Same output as Print::print(double, digits) for up to 9 digits (more are
+// clipped), with "nan", "inf" and "ovf" for values out of the 32-bit range.
+extern char* formatDouble( double number, uint8_t digits, char *end ) ;
+
+extern const uint32_t g_formatPowersOf10[10] ;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
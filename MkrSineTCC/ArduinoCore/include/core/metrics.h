@@ -0,0 +1,178 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _METRICS_
+#define _METRICS_
+
+#include <stdint.h>
+#include "sam.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Statically allocated metrics which interrupt handlers may update at any priority.
+ * Cortex-M0+ has no LDREX/STREX, so each update is a read-modify-write done with
+ * interrupts masked through PRIMASK for a handful of cycles.
+ *
+ * Kinds of metrics:
+ *   counter    - number of events
+ *   max gauge  - largest value seen since the last reset
+ *   histogram  - number of samples per bucket, bucket i counts values below
+ *                METRIC_HISTOGRAM_FIRST_LIMIT << (2*i), the last one all above
+ *
+ * Metrics are defined with METRIC_COUNTER(), METRIC_MAX_GAUGE() or METRIC_HISTOGRAM()
+ * and become enumerable once passed to metricRegister(). The metrics of the core
+ * (USB, EIC, ADC and DMA) are registered from the start.
+ */
+typedef enum
+{
+  METRIC_KIND_COUNTER = 0,
+  METRIC_KIND_MAX_GAUGE,
+  METRIC_KIND_HISTOGRAM
+} MetricKind ;
+
+#define METRIC_HISTOGRAM_BUCKETS 8
+#define METRIC_HISTOGRAM_FIRST_LIMIT 64
+
+typedef struct Metric
+{
+  const char *name ;
+  MetricKind kind ;
+  struct Metric *next ;
+  volatile uint32_t value ; // counter: events, max gauge: maximum, histogram: samples
+} Metric ;
+
+typedef struct
+{
+  Metric metric ;
+  volatile uint32_t buckets[METRIC_HISTOGRAM_BUCKETS] ;
+} MetricHistogram ;
+
+// consistent copy of a metric taken by metricSnapshot()
+typedef struct
+{
+  const char *name ;
+  MetricKind kind ;
+  uint32_t value ;
+  uint32_t buckets[METRIC_HISTOGRAM_BUCKETS] ; // histograms only
+} MetricSnapshot ;
+
+#define METRIC_COUNTER(var, name) Metric var = { name, METRIC_KIND_COUNTER, 0, 0 }
+#define METRIC_MAX_GAUGE(var, name) Metric var = { name, METRIC_KIND_MAX_GAUGE, 0, 0 }
+#define METRIC_HISTOGRAM(var, name) MetricHistogram var = { { name, METRIC_KIND_HISTOGRAM, 0, 0 }, { 0 } }
+
+static inline void metricAdd( Metric *metric, uint32_t n )
+{
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  metric->value += n ;
+  __set_PRIMASK( primask ) ;
+}
+
+static inline void metricIncrement( Metric *metric )
+{
+  metricAdd( metric, 1 ) ;
+}
+
+static inline void metricUpdateMax( Metric *metric, uint32_t value )
+{
+  // cheap unmasked check first, the maximum only grows
+  if ( value <= metric->value )
+  {
+    return ;
+  }
+
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  if ( value > metric->value )
+  {
+    metric->value = value ;
+  }
+  __set_PRIMASK( primask ) ;
+}
+
+static inline void metricRecord( MetricHistogram *histogram, uint32_t value )
+{
+  int bucket = 0 ;
+  uint32_t limit = METRIC_HISTOGRAM_FIRST_LIMIT ;
+  while ( value >= limit && bucket < METRIC_HISTOGRAM_BUCKETS - 1 )
+  {
+    limit <<= 2 ;
+    bucket++ ;
+  }
+
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  histogram->metric.value++ ;
+  histogram->buckets[bucket]++ ;
+  __set_PRIMASK( primask ) ;
+}
+
+/*
+ * CPU cycle stamps for measuring short intervals such as interrupt handler
+ * durations, taken from the SysTick down-counter (no cycle counter on M0+).
+ * Intervals must be shorter than one SysTick period (1ms).
+ */
+static inline uint32_t metricCycleStamp( void )
+{
+  return SysTick->VAL ;
+}
+
+static inline uint32_t metricCyclesSince( uint32_t stamp )
+{
+  uint32_t now = SysTick->VAL ;
+  return stamp >= now ? stamp - now : stamp + (SysTick->LOAD + 1) - now ;
+}
+
+/**
+ * \brief Adds a metric to the enumerable list, registering it twice has no effect.
+ *
+ * Call from the main loop or setup(), not from interrupt handlers.
+ */
+extern void metricRegister( Metric *metric ) ;
+
+/**
+ * \brief Returns the first registered metric, continue with metric->next.
+ */
+extern Metric *metricFirst( void ) ;
+
+/**
+ * \brief Copies a metric consistently, optionally resetting it to zero.
+ */
+extern void metricSnapshot( Metric *metric, MetricSnapshot *snapshot, int reset ) ;
+
+/**
+ * \brief Returns the upper limit of a histogram bucket, 0 for the last unbounded one.
+ */
+extern uint32_t metricBucketLimit( int bucket ) ;
+
+// metrics of the core
+extern Metric g_metricUsbInterrupts ;
+extern MetricHistogram g_metricUsbIsrCycles ;
+extern Metric g_metricEicInterrupts ;
+extern MetricHistogram g_metricEicIsrCycles ;
+extern Metric g_metricAdcReads ;
+extern MetricHistogram g_metricAdcReadCycles ;
+extern Metric g_metricDmaInterrupts ;
+extern MetricHistogram g_metricDmaIsrCycles ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _METRICS_ */
@@ -0,0 +1,79 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef _TIMEBASE_
+#define _TIMEBASE_
+
+#include <stdint.h>
+#include "sam.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 64-bit monotonic timebase: TC4 and TC5 cascaded into one 32-bit counter at
+ * the CPU clock, extended by software on overflow (every 89s at 48 MHz).
+ * Reading it takes a constant number of cycles with interrupts masked only
+ * briefly, so it can be used from any context including interrupt handlers.
+ * Started by initTimebase(). TC4 and TC5 are not available for tone() or
+ * analogWrite() as a consequence.
+ *
+ * It also makes the core tickless: millis() and delay() are based on it and
+ * SysTick only interrupts while a reset is pending (see Reset.cpp). The
+ * SysTick counter keeps running for the cycle stamps of metrics.h.
+ */
+#define TIMEBASE_TC TC4 // TC5 is its slave in 32-bit mode
+#define TIMEBASE_CYCLES_PER_MICROSECOND (VARIANT_MCK / 1000000)
+
+extern void timebaseInit( void ) ;
+
+/**
+ * \brief Returns the CPU cycles since timebaseInit().
+ */
+extern uint64_t timebaseCycles( void ) ;
+
+/**
+ * \brief Returns the microseconds since timebaseInit().
+ */
+extern uint64_t timebaseMicros( void ) ;
+
+extern uint64_t timebaseMillis( void ) ;
+
+extern uint64_t timebaseCyclesToMicros( uint64_t cycles ) ;
+extern uint64_t timebaseCyclesToMillis( uint64_t cycles ) ;
+
+/**
+ * \brief Sleeps (WFI) until the given timebaseCycles() or any interrupt, whichever comes first.
+ *
+ * Returns at once if the time is less than a few hundred cycles away.
+ * Thread mode only: the timebase interrupt has the lowest priority and cannot
+ * wake a handler, see delay().
+ */
+extern void timebaseSleepUntil( uint64_t cycles ) ;
+
+/**
+ * \brief Returns the lower 32 bits of timebaseCycles(), for intervals below 89s.
+ */
+static inline uint32_t timebaseCycles32( void )
+{
+  return TIMEBASE_TC->COUNT32.COUNT.reg ;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TIMEBASE_ */
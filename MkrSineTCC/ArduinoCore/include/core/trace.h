@@ -0,0 +1,86 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _TRACE_
+#define _TRACE_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Circular buffer of the last TRACE_CAPACITY events, written from any context
+ * including interrupt handlers. The buffer lives in the .noinit RAM section, so
+ * it survives any reset except power loss: after a reset new events are appended
+ * behind a TRACE_EVENT_RESET record. traceFreeze() stops recording (used on panic)
+ * and the frozen buffer is kept across resets until traceResume().
+ *
+ * Each record holds a timestamp (the lower 32 bits of timebaseCycles(), wrapping
+ * every 89s), an 8-bit event id and a 24-bit argument.
+ */
+#define TRACE_CAPACITY 256 // records, a power of two
+
+typedef enum
+{
+  TRACE_EVENT_RESET = 1,      // arg: PM->RCAUSE
+  TRACE_EVENT_USB_INTERRUPT,  // arg: EPINTSMRY << 16 | INTFLAG, Start-Of-Frame alone is not traced
+  TRACE_EVENT_PANIC,          // arg: panic code
+  TRACE_EVENT_USER = 0x40     // first id for application events
+} TraceEvent ;
+
+typedef struct
+{
+  uint32_t time ;
+  uint32_t eventAndArg ; // event << 24 | arg
+} TraceRecord ;
+
+/**
+ * \brief Appends an event, arg is truncated to 24 bits.
+ */
+extern void traceEvent( uint8_t event, uint32_t arg ) ;
+
+/**
+ * \brief Validates the buffer after reset, called by main() before setupEarly().
+ */
+extern void traceInit( void ) ;
+
+extern void traceFreeze( void ) ;
+extern int traceIsFrozen( void ) ;
+
+/**
+ * \brief Clears the buffer and continues recording.
+ */
+extern void traceResume( void ) ;
+
+/**
+ * \brief Returns the number of records written since the buffer was cleared.
+ *
+ * Records older than the last TRACE_CAPACITY ones are overwritten.
+ */
+extern uint32_t traceCount( void ) ;
+
+/**
+ * \brief Returns a record counted from the oldest one still in the buffer.
+ */
+extern const TraceRecord *traceRecord( uint32_t index ) ;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TRACE_ */
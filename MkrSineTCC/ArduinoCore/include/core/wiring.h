@@ -23,6 +23,8 @@ extern "C" {
 #endif
 
 extern void init(void);
+extern void initTimebase(void);
+extern void initPeripherals(void);
 
 #ifdef __cplusplus
 }
@@ -20,6 +20,7 @@
 #include "Arduino.h"
 
 #include "Print.h"
+#include "format.h"
 
 // Public Methods //////////////////////////////////////////////////////////////
 
@@ -74,12 +75,12 @@ size_t Print::print(long n, int base)
   if (base == 0) {
     return write(n);
   } else if (base == 10) {
-    if (n < 0) {
-      int t = print('-');
-      n = -n;
-      return printNumber(n, 10) + t;
-    }
-    return printNumber(n, 10);
+    // sign and digits in a single write
+    char buf[FORMAT_BUFFER_SIZE];
+    char *end = &buf[sizeof(buf)];
+    char *str = formatDecimal(n < 0 ? 0ul - (unsigned long)n : (unsigned long)n, end);
+    if (n < 0) *--str = '-';
+    return write(str, end - str);
   } else {
     return printNumber(n, base);
   }
@@ -187,26 +188,22 @@ size_t Print::println(const Printable& x)
 
 size_t Print::printNumber(unsigned long n, uint8_t base)
 {
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
-
-  *str = '\0';
-
-  // prevent crash if called with base == 1
-  if (base < 2) base = 10;
-
-  do {
-    char c = n % base;
-    n /= base;
-
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-  } while(n);
-
-  return write(str);
+  char buf[FORMAT_BUFFER_SIZE];
+  char *end = &buf[sizeof(buf)];
+  char *str = formatBase(n, base, end);
+  return write(str, end - str);
 }
 
 size_t Print::printFloat(double number, uint8_t digits)
 {
+  // up to 9 digits are formatted at once and sent in a single write
+  if (digits <= 9) {
+    char buf[FORMAT_BUFFER_SIZE];
+    char *end = &buf[sizeof(buf)];
+    char *str = formatDouble(number, digits, end);
+    return write(str, end - str);
+  }
+
   size_t n = 0;
 
   if (isnan(number)) return print("nan");
@@ -249,3 +246,11 @@ size_t Print::printFloat(double number, uint8_t digits)
 
   return n;
 }
+
+size_t Print::printFixed(long value, uint8_t fractionalBits, uint8_t digits)
+{
+  char buf[FORMAT_BUFFER_SIZE];
+  char *end = &buf[sizeof(buf)];
+  char *str = formatFixed(value, fractionalBits, digits, end);
+  return write(str, end - str);
+}
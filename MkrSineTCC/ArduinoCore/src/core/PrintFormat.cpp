@@ -0,0 +1,203 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+#include "PrintFormat.h"
+
+#define MAX_WIDTH 16
+
+// Hands the current span over and gets the next one, the transmit buffer
+// of the output if it lends one, else the local buffer.
+void FormatWriter::nextSpan()
+{
+  if (reserved) {
+    out.commit(span - start);
+    total += span - start;
+  } else if (span != start) {
+    total += out.write(start, span - start);
+  }
+
+  size_t room = out.reserve(&start);
+  reserved = room > 0;
+  if (!reserved) {
+    out.commit(0);
+    start = local;
+    room = sizeof(local);
+  }
+  span = start;
+  spanEnd = start + room;
+}
+
+void FormatWriter::write(const char *data, size_t size)
+{
+  while (size > 0) {
+    if (span == spanEnd) nextSpan();
+
+    size_t n = spanEnd - span;
+    if (n > size) n = size;
+    memcpy(span, data, n);
+    span += n;
+    data += n;
+    size -= n;
+  }
+}
+
+size_t FormatWriter::finish()
+{
+  if (reserved) {
+    out.commit(span - start);
+    total += span - start;
+  } else if (span != start) {
+    total += out.write(start, span - start);
+  }
+  reserved = false;
+  start = span = spanEnd = 0;
+  return total;
+}
+
+const char *FormatWriter::writeUntilPlaceholder(const char *format, FormatSpec *spec)
+{
+  const char *literal = format;
+  for (;;) {
+    if (*format == 0) {
+      write(literal, format - literal);
+      return NULL;
+    }
+    if (*format == '{') {
+      write(literal, format - literal);
+      if (format[1] == '{') {
+        // escaped brace, continue with the second one as literal
+        literal = ++format;
+        format++;
+        continue;
+      }
+      break;
+    }
+    if (*format == '}' && format[1] == '}') {
+      write(literal, format + 1 - literal);
+      format += 2;
+      literal = format;
+      continue;
+    }
+    format++;
+  }
+
+  // {[0][width][x|o|b][.digits]}
+  spec->base = DEC;
+  spec->width = 0;
+  spec->digits = 2;
+  spec->zeroPad = false;
+  format++;
+  if (*format == '0') {
+    spec->zeroPad = true;
+    format++;
+  }
+  while (*format >= '0' && *format <= '9') {
+    spec->width = spec->width * 10 + (*format++ - '0');
+  }
+  if (spec->width > MAX_WIDTH) spec->width = MAX_WIDTH;
+  switch (*format) {
+    case 'x': case 'X': spec->base = HEX; format++; break;
+    case 'o': spec->base = OCT; format++; break;
+    case 'b': spec->base = BIN; format++; break;
+  }
+  if (*format == '.') {
+    spec->digits = 0;
+    while (*++format >= '0' && *format <= '9') {
+      spec->digits = spec->digits * 10 + (*format - '0');
+    }
+  }
+  while (*format != 0 && *format != '}') format++;
+  return *format == '}' ? format + 1 : format;
+}
+
+void FormatWriter::writeNumber(unsigned long magnitude, bool negative, const FormatSpec &spec)
+{
+  char buf[FORMAT_BUFFER_SIZE];
+  char *end = &buf[sizeof(buf)];
+  char *str = formatBase(magnitude, spec.base, end);
+  if (negative) *--str = '-';
+
+  writePadded(str, end - str, spec, true);
+}
+
+// Right-aligns to the width of the spec: numbers get their zeros between sign
+// and digits ("nan" and "inf" stay space padded), everything else spaces.
+void FormatWriter::writePadded(const char *str, size_t length, const FormatSpec &spec, bool number)
+{
+  size_t pad = spec.width > length ? spec.width - length : 0;
+  size_t sign = (length > 0 && *str == '-') ? 1 : 0;
+  char fill = ' ';
+  if (number && spec.zeroPad && sign < length && str[sign] >= '0' && str[sign] <= '9') {
+    fill = '0';
+    write(str, sign);
+    str += sign;
+    length -= sign;
+  }
+  while (pad-- > 0) write(&fill, 1);
+
+  write(str, length);
+}
+
+void formatArgument(FormatWriter &w, const FormatSpec &spec, char c)
+{
+  w.writePadded(&c, 1, spec, false);
+}
+
+void formatArgument(FormatWriter &w, const FormatSpec &spec, const char *s)
+{
+  if (s == NULL) s = "(null)";
+  w.writePadded(s, strlen(s), spec, false);
+}
+
+void formatArgument(FormatWriter &w, const FormatSpec &spec, bool b)
+{
+  if (b) w.writePadded("true", 4, spec, false);
+  else w.writePadded("false", 5, spec, false);
+}
+
+void formatArgument(FormatWriter &w, const FormatSpec &spec, long n)
+{
+  w.writeNumber(n < 0 ? 0ul - (unsigned long)n : (unsigned long)n, n < 0, spec);
+}
+
+void formatArgument(FormatWriter &w, const FormatSpec &spec, unsigned long n)
+{
+  w.writeNumber(n, false, spec);
+}
+
+void formatArgument(FormatWriter &w, const FormatSpec &spec, double n)
+{
+  char buf[FORMAT_BUFFER_SIZE];
+  char *end = &buf[sizeof(buf)];
+  char *str = formatDouble(n, spec.digits, end);
+  w.writePadded(str, end - str, spec, true);
+}
+
+void formatArgument(FormatWriter &w, const FormatSpec &spec, const void *p)
+{
+  FormatSpec hex = { HEX, 8, 0, true };
+  w.write("0x", 2);
+  w.writeNumber((unsigned long)p, false, hex);
+}
+
+void formatArgument(FormatWriter &w, const FormatSpec &spec, const FormatFixed &f)
+{
+  char buf[FORMAT_BUFFER_SIZE];
+  char *end = &buf[sizeof(buf)];
+  char *str = formatFixed(f.value, f.fractionalBits, f.digits, end);
+  w.writePadded(str, end - str, spec, true);
+}
@@ -71,10 +71,13 @@ static int ticks = -1;
 void initiateReset(int _ticks) {
 	resetExternalChip();
 	ticks = _ticks;
+	// count the ticks down in the SysTick interrupt
+	SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
 }
 
 void cancelReset() {
 	ticks = -1;
+	SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
 }
 
 void tickReset() {
@@ -196,6 +196,43 @@ void SERCOM::disableDataRegisterEmptyInterruptUART()
   sercom->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_DRE;
 }
 
+void SERCOM::enableReceiveInterruptUART()
+{
+  sercom->USART.INTENSET.reg = SERCOM_USART_INTENSET_RXC;
+}
+
+void SERCOM::disableReceiveInterruptUART()
+{
+  sercom->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_RXC;
+}
+
+volatile void *SERCOM::dataRegisterUART()
+{
+  return &sercom->USART.DATA.reg;
+}
+
+// DMAC trigger sources, the TX one follows the RX one for every SERCOM
+uint8_t SERCOM::getDmacTriggerRx()
+{
+  if(sercom == SERCOM0) return SERCOM0_DMAC_ID_RX;
+  if(sercom == SERCOM1) return SERCOM1_DMAC_ID_RX;
+  if(sercom == SERCOM2) return SERCOM2_DMAC_ID_RX;
+  if(sercom == SERCOM3) return SERCOM3_DMAC_ID_RX;
+  #if defined(SERCOM4)
+  if(sercom == SERCOM4) return SERCOM4_DMAC_ID_RX;
+  #endif // SERCOM4
+  #if defined(SERCOM5)
+  if(sercom == SERCOM5) return SERCOM5_DMAC_ID_RX;
+  #endif // SERCOM5
+  return 0;
+}
+
+uint8_t SERCOM::getDmacTriggerTx()
+{
+  uint8_t rx = getDmacTriggerRx();
+  return rx == 0 ? 0 : rx + 1;
+}
+
 /*	=========================
  *	===== Sercom SPI
  *	=========================
@@ -203,10 +203,20 @@ size_t Stream::readBytes(char *buffer, size_t length)
 {
   size_t count = 0;
   while (count < length) {
+    // copy whole buffered blocks if the stream can lend them
+    const uint8_t *data;
+    size_t n = borrow(&data);
+    if (n > 0) {
+      if (n > length - count) n = length - count;
+      memcpy(buffer + count, data, n);
+      release(n);
+      count += n;
+      continue;
+    }
+
     int c = timedRead();
     if (c < 0) break;
-    *buffer++ = (char)c;
-    count++;
+    buffer[count++] = (char)c;
   }
   return count;
 }
@@ -221,10 +231,25 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
   if (length < 1) return 0;
   size_t index = 0;
   while (index < length) {
+    const uint8_t *data;
+    size_t n = borrow(&data);
+    if (n > 0) {
+      if (n > length - index) n = length - index;
+      const uint8_t *end = (const uint8_t *)memchr(data, terminator, n);
+      size_t copied = end ? (size_t)(end - data) : n;
+      memcpy(buffer + index, data, copied);
+      index += copied;
+      if (end) {
+        release(copied + 1); // terminator is consumed but not stored
+        break;
+      }
+      release(copied);
+      continue;
+    }
+
     int c = timedRead();
     if (c < 0 || c == terminator) break;
-    *buffer++ = (char)c;
-    index++;
+    buffer[index++] = (char)c;
   }
   return index; // return number of characters, not including null terminator
 }
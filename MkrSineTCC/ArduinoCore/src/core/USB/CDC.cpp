@@ -206,50 +206,45 @@ void Serial_::end(void)
 	memset((void*)&_usbLineInfo, 0, sizeof(_usbLineInfo));
 }
 
-int _serialPeek = -1;
-
 int Serial_::available(void)
 {
-	return usb.available(CDC_ENDPOINT_OUT) + (_serialPeek != -1);
+	return usb.available(CDC_ENDPOINT_OUT);
 }
 
 int Serial_::availableForWrite(void)
 {
-	// return the number of bytes left in the current bank,
-	// always EP size - 1, because bank is flushed on every write
-	return (EPX_SIZE - 1);
+	// return the number of bytes left in the transmit buffer
+	return usb.availableForWrite(CDC_ENDPOINT_IN);
 }
 
 int Serial_::peek(void)
 {
-	if (_serialPeek != -1)
-		return _serialPeek;
-	_serialPeek = read();
-	return _serialPeek;
+	return usb.peek(CDC_ENDPOINT_OUT);
 }
 
 int Serial_::read(void)
 {
-	if (_serialPeek != -1) {
-		int res = _serialPeek;
-		_serialPeek = -1;
-		return res;
-	}
 	return usb.recv(CDC_ENDPOINT_OUT);
 }
 
-size_t Serial_::readBytes(char *buffer, size_t length)
+size_t Serial_::borrow(const uint8_t **data)
 {
-	size_t count = 0;
-	_startMillis = millis();
-	while (count < length)
-	{
-		uint32_t n = usb.recv(CDC_ENDPOINT_OUT, buffer+count, length-count);
-		if (n == 0 && (millis() - _startMillis) >= _timeout)
-			break;
-		count += n;
-	}
-	return count;
+	return usb.borrow(CDC_ENDPOINT_OUT, data);
+}
+
+void Serial_::release(size_t length)
+{
+	usb.release(CDC_ENDPOINT_OUT, length);
+}
+
+size_t Serial_::reserve(uint8_t **data)
+{
+	return usb.reserve(CDC_ENDPOINT_IN, data);
+}
+
+void Serial_::commit(size_t length)
+{
+	usb.commit(CDC_ENDPOINT_IN, length);
 }
 
 void Serial_::flush(void)
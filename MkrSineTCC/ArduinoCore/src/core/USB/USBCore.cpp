@@ -46,7 +46,14 @@ extern void (*gpf_isr)(void);
 
 // USB_Handler ISR
 extern "C" void UDD_Handler(void) {
+	uint32_t stamp = metricCycleStamp();
+	uint32_t flags = USB->DEVICE.INTFLAG.reg;
+	uint32_t endpoints = USB->DEVICE.EPINTSMRY.reg;
+	if (endpoints != 0 || (flags & ~USB_DEVICE_INTFLAG_SOF) != 0)
+		traceEvent(TRACE_EVENT_USB_INTERRUPT, (endpoints << 16) | flags);
 	USBDevice.ISRHandler();
+	metricIncrement(&g_metricUsbInterrupts);
+	metricRecord(&g_metricUsbIsrCycles, metricCyclesSince(stamp));
 }
 
 const uint16_t STRING_LANGUAGE[2] = {
@@ -93,6 +100,7 @@ uint8_t udd_ep_in_cache_buffer[7][64];
 // Possibly all the sparse EP handling subroutines will be
 // converted into reusable EPHandlers in the future.
 static EPHandler *epHandlers[7] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+static EPInHandler *epInHandlers[7] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL};
 
 //==================================================================
 
@@ -299,8 +307,9 @@ void USBDeviceClass::init()
 	usbd.runInStandby();
 	usbd.setFullSpeed();
 
-	// Configure interrupts
-	NVIC_SetPriority((IRQn_Type) USB_IRQn, 0UL);
+	// Configure interrupts: one level below the highest, so timer interrupts
+	// already running (e.g. started by setupEarly()) preempt USB enumeration
+	NVIC_SetPriority((IRQn_Type) USB_IRQn, 1UL);
 	NVIC_EnableIRQ((IRQn_Type) USB_IRQn);
 
 	usbd.enable();
@@ -416,9 +425,10 @@ void USBDeviceClass::initEP(uint32_t ep, uint32_t config)
 	}
 	else if (config == (USB_ENDPOINT_TYPE_BULK | USB_ENDPOINT_IN(0)))
 	{
-		usbd.epBank1SetSize(ep, 64);
-		usbd.epBank1SetAddress(ep, &udd_ep_in_cache_buffer[ep]);
-		usbd.epBank1SetType(ep, 3); // BULK IN
+		if (epInHandlers[ep] != NULL) {
+			delete (BufferedEPInHandler*)epInHandlers[ep];
+		}
+		epInHandlers[ep] = new BufferedEPInHandler(usbd, ep);
 	}
 	else if (config == USB_ENDPOINT_TYPE_CONTROL)
 	{
@@ -439,6 +449,11 @@ void USBDeviceClass::initEP(uint32_t ep, uint32_t config)
 
 void USBDeviceClass::flush(uint32_t ep)
 {
+	if (epInHandlers[ep]) {
+		epInHandlers[ep]->flush();
+		return;
+	}
+
 	if (available(ep)) {
 		// RAM buffer is full, we can send data (IN)
 		usbd.epBank1SetReady(ep);
@@ -449,6 +464,11 @@ void USBDeviceClass::flush(uint32_t ep)
 }
 
 void USBDeviceClass::clear(uint32_t ep) {
+	if (epInHandlers[ep]) {
+		epInHandlers[ep]->clear();
+		return;
+	}
+
 	usbd.epBank1SetAddress(ep, &udd_ep_in_cache_buffer[ep]);
 	usbd.epBank1SetByteCount(ep, 0);
 
@@ -504,6 +524,38 @@ uint32_t USBDeviceClass::available(uint32_t ep)
 	}
 }
 
+// Zero-copy send: lends the free space of the transmit buffer, 0 for
+// endpoints without an EPInHandler. Must be followed by commit().
+uint32_t USBDeviceClass::reserve(uint32_t ep, uint8_t **data)
+{
+	if (!_usbConfiguration)
+		return 0;
+
+	if (epInHandlers[ep]) {
+		return epInHandlers[ep]->reserve(data);
+	}
+	return 0;
+}
+
+// Appends len bytes written into the space lent by reserve()
+void USBDeviceClass::commit(uint32_t ep, uint32_t len)
+{
+	if (epInHandlers[ep]) {
+		epInHandlers[ep]->commit(len);
+	}
+}
+
+// Number of bytes which can be sent without blocking, assumes a tx endpoint
+uint32_t USBDeviceClass::availableForWrite(uint32_t ep)
+{
+	if (epInHandlers[ep]) {
+		return epInHandlers[ep]->availableForWrite();
+	} else {
+		// bank is flushed on every write
+		return EPX_SIZE - 1;
+	}
+}
+
 // Non Blocking receive
 // Return number of bytes read
 uint32_t USBDeviceClass::recv(uint32_t ep, void *_data, uint32_t len)
@@ -556,6 +608,37 @@ int USBDeviceClass::recv(uint32_t ep)
 	}
 }
 
+// Next byte without consuming it, assumes a rx endpoint
+int USBDeviceClass::peek(uint32_t ep)
+{
+	if (epHandlers[ep]) {
+		return epHandlers[ep]->peek();
+	}
+	return -1;
+}
+
+// Zero-copy receive: lends the received data in place and returns its length,
+// the data stays valid until release(). Only endpoints with an EPHandler
+// support it, others always return 0.
+uint32_t USBDeviceClass::borrow(uint32_t ep, const uint8_t **data)
+{
+	if (!_usbConfiguration)
+		return 0;
+
+	if (epHandlers[ep]) {
+		return epHandlers[ep]->borrow(data);
+	}
+	return 0;
+}
+
+// Consumes len bytes lent by borrow()
+void USBDeviceClass::release(uint32_t ep, uint32_t len)
+{
+	if (epHandlers[ep]) {
+		epHandlers[ep]->release(len);
+	}
+}
+
 uint8_t USBDeviceClass::armRecvCtrlOUT(uint32_t ep)
 {
 	// Get endpoint configuration from setting register
@@ -612,6 +695,31 @@ uint32_t USBDeviceClass::send(uint32_t ep, const void *data, uint32_t len)
 	txLEDPulse = TX_RX_LED_PULSE_MS;
 #endif
 
+	// Buffered endpoints wait for room while the host takes data, and give up
+	// after TX_TIMEOUT_MS without progress (at once while timed out before).
+	// Non-blocking writers check availableForWrite() or use reserve().
+	if (epInHandlers[ep]) {
+		uint32_t start = millis();
+		while (len != 0) {
+			length = epInHandlers[ep]->send(data, len);
+			if (length > 0) {
+				LastTransmitTimedOut[ep] = 0;
+				written += length;
+				len -= length;
+				data = (const char *)data + length;
+				start = millis();
+				continue;
+			}
+			if (LastTransmitTimedOut[ep] || millis() - start >= TX_TIMEOUT_MS) {
+				LastTransmitTimedOut[ep] = 1;
+				break;
+			}
+			// also makes progress when the USB interrupt is blocked
+			epInHandlers[ep]->flush();
+		}
+		return written;
+	}
+
 	// Flash area
 	while (len != 0)
 	{
@@ -856,6 +964,13 @@ void USBDeviceClass::ISRHandler()
 				digitalWrite(PIN_LED_RXL, HIGH);
 		}
 #endif
+
+		// send partial packets buffered during the last frame
+		for (int ep = 1; ep < USB_EPT_NUM; ep++) {
+			if (epInHandlers[ep]) {
+				epInHandlers[ep]->handleStartOfFrame();
+			}
+		}
 	}
 
 	/* Remove any stall requests for endpoint #0 */
@@ -907,6 +1022,8 @@ void USBDeviceClass::ISRHandler()
 		if (usbd.epHasPendingInterrupts(ep)) {
 			if (epHandlers[ep]) {
 				epHandlers[ep]->handleEndpoint();
+			} else if (epInHandlers[ep]) {
+				epInHandlers[ep]->handleEndpoint();
 			} else {
 				#if defined(PLUGGABLE_USB_ENABLED)
 				PluggableUSB().handleEndpoint(ep);
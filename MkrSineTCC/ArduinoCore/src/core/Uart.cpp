@@ -38,6 +38,11 @@ Uart::Uart(SERCOM *_s, uint8_t _pinRX, uint8_t _pinTX, SercomRXPad _padRX, Serco
   uc_padTX = _padTX;
   uc_pinRTS = _pinRTS;
   uc_pinCTS = _pinCTS;
+  rxDmaChannel = -1;
+  txDmaChannel = -1;
+  txDmaCount = 0;
+  rxIdleHead = 0;
+  rxIdleStamp = 0;
 }
 
 void Uart::begin(unsigned long baudrate)
@@ -76,6 +81,7 @@ void Uart::begin(unsigned long baudrate, uint16_t config)
 
 void Uart::end()
 {
+  disableDma();
   sercom->resetUART();
   rxBuffer.clear();
   txBuffer.clear();
@@ -88,8 +94,178 @@ void Uart::flush()
   sercom->flushUART();
 }
 
+int Uart::enableDma()
+{
+  if (txDmaChannel >= 0) {
+    return 0;
+  }
+
+  int rx = dmaAllocate();
+  int tx = dmaAllocate();
+  if (rx < 0 || tx < 0) {
+    if (rx >= 0) dmaFree(rx);
+    if (tx >= 0) dmaFree(tx);
+    return 1;
+  }
+
+  flush();
+
+  // the receive channel writes the RX ring buffer in circles, the buffer head
+  // follows its position, see updateRxDmaHead()
+  DmacDescriptor *descriptor = dmaDescriptor(rx);
+  dmaSetupBlock(descriptor, sercom->dataRegisterUART(), rxBuffer._aucBuffer, SERIAL_BUFFER_SIZE,
+    DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_DSTINC | DMAC_BTCTRL_BLOCKACT_INT);
+  descriptor->DESCADDR.reg = (uint32_t)descriptor;
+  dmaConfigure(rx, sercom->getDmacTriggerRx(), DMAC_CHCTRLB_TRIGACT_BEAT);
+  dmaSetCallback(rx, rxDmaCallback, this, DMAC_CHINTENSET_TCMPL);
+
+  dmaConfigure(tx, sercom->getDmacTriggerTx(), DMAC_CHCTRLB_TRIGACT_BEAT);
+  dmaSetCallback(tx, txDmaCallback, this, DMAC_CHINTENSET_TCMPL);
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  sercom->disableReceiveInterruptUART();
+  sercom->disableDataRegisterEmptyInterruptUART();
+  rxBuffer.clear(); // unread bytes are dropped, the DMAC starts at the buffer start
+  rxDmaLaps = 0;
+  rxDmaChannel = rx;
+  txDmaChannel = tx;
+  txDmaCount = 0;
+  dmaStart(rx);
+  __set_PRIMASK(primask);
+
+  return 0;
+}
+
+void Uart::disableDma()
+{
+  if (txDmaChannel < 0) {
+    return;
+  }
+
+  flush();
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  // bytes received so far stay readable
+  updateRxDmaHead();
+  dmaFree(rxDmaChannel);
+  dmaFree(txDmaChannel);
+  rxDmaChannel = -1;
+  txDmaChannel = -1;
+  txDmaCount = 0;
+  sercom->enableReceiveInterruptUART();
+  __set_PRIMASK(primask);
+}
+
+void Uart::rxDmaCallback(void *uart, uint8_t flags)
+{
+  // once per lap through the buffer, counted so the head never misses a lap
+  Uart *self = static_cast<Uart *>(uart);
+  self->rxDmaLaps++;
+  self->updateRxDmaHead();
+}
+
+void Uart::txDmaCallback(void *uart, uint8_t flags)
+{
+  Uart *self = static_cast<Uart *>(uart);
+  self->txBuffer.release(self->txDmaCount);
+  self->txDmaCount = 0;
+  self->startTxDma();
+}
+
+// Called with interrupts masked or from the DMAC interrupt.
+void Uart::updateRxDmaHead()
+{
+  if (rxDmaChannel < 0) {
+    return;
+  }
+
+  // a lap completed but not counted yet reads as a step back, the head then
+  // waits for rxDmaCallback()
+  uint32_t position = SERIAL_BUFFER_SIZE - dmaRemaining(rxDmaChannel);
+  uint32_t head = rxDmaLaps * SERIAL_BUFFER_SIZE + position;
+  if ((int32_t)(head - rxBuffer._iHead) > 0) {
+    rxBuffer._iHead = head;
+  }
+}
+
+void Uart::pollRxDma()
+{
+  if (rxDmaChannel < 0) {
+    return;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  updateRxDmaHead();
+  __set_PRIMASK(primask);
+
+  // the DMAC does not wait for the reader, drop what it has overwritten
+  if (rxBuffer.available() > SERIAL_BUFFER_SIZE) {
+    rxBuffer.release(rxBuffer.available() - SERIAL_BUFFER_SIZE);
+  }
+}
+
+// Called with interrupts masked or from the DMAC interrupt.
+void Uart::startTxDma()
+{
+  if (txDmaChannel < 0 || txDmaCount != 0) {
+    return;
+  }
+
+  const uint8_t *data;
+  int size = txBuffer.borrow(&data);
+  if (size == 0) {
+    return;
+  }
+
+  dmaSetupBlock(dmaDescriptor(txDmaChannel), data, sercom->dataRegisterUART(), size,
+    DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC);
+  txDmaCount = size;
+  dmaStart(txDmaChannel);
+}
+
+void Uart::startTransmit()
+{
+  if (txDmaChannel >= 0) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    startTxDma();
+    __set_PRIMASK(primask);
+  } else {
+    sercom->enableDataRegisterEmptyInterruptUART();
+  }
+}
+
+bool Uart::receiveIdle(uint32_t idleMicros)
+{
+  pollRxDma();
+
+  uint32_t head = rxBuffer._iHead;
+  uint32_t now = micros();
+  if (head != rxIdleHead) {
+    rxIdleHead = head;
+    rxIdleStamp = now;
+    return false;
+  }
+  return rxBuffer.available() > 0 && now - rxIdleStamp >= idleMicros;
+}
+
 void Uart::IrqHandler()
 {
+  if (txDmaChannel >= 0) {
+    // data moves by DMA, errors only
+    if (sercom->isFrameErrorUART()) {
+      sercom->clearFrameErrorUART();
+    }
+    if (sercom->isUARTError()) {
+      sercom->acknowledgeUARTError();
+      sercom->clearStatusUART();
+    }
+    return;
+  }
+
   if (sercom->isFrameErrorUART()) {
     // frame error, next byte is invalid so read and discard it
     sercom->readDataUART();
@@ -97,7 +273,8 @@ void Uart::IrqHandler()
     sercom->clearFrameErrorUART();
   }
 
-  if (sercom->availableDataUART()) {
+  // drain the receive FIFO in one interrupt
+  while (sercom->availableDataUART()) {
     rxBuffer.store_char(sercom->readDataUART());
 
     if (uc_pinRTS != NO_RTS_PIN) {
@@ -128,6 +305,7 @@ void Uart::IrqHandler()
 
 int Uart::available()
 {
+  pollRxDma();
   return rxBuffer.available();
 }
 
@@ -138,21 +316,41 @@ int Uart::availableForWrite()
 
 int Uart::peek()
 {
+  pollRxDma();
   return rxBuffer.peek();
 }
 
 int Uart::read()
 {
+  pollRxDma();
   int c = rxBuffer.read_char();
 
+  updateRTS();
+
+  return c;
+}
+
+size_t Uart::borrow(const uint8_t **data)
+{
+  pollRxDma();
+  return rxBuffer.borrow(data);
+}
+
+void Uart::release(size_t size)
+{
+  rxBuffer.release(size);
+
+  updateRTS();
+}
+
+void Uart::updateRTS()
+{
   if (uc_pinRTS != NO_RTS_PIN) {
     // if there is enough space in the RX buffer, assert RTS
     if (rxBuffer.availableForStore() > RTS_RX_THRESHOLD) {
       *pul_outclrRTS = ul_pinMaskRTS;
     }
   }
-
-  return c;
 }
 
 size_t Uart::write(const uint8_t data)
@@ -160,36 +358,60 @@ size_t Uart::write(const uint8_t data)
   if (sercom->isDataRegisterEmptyUART() && txBuffer.available() == 0) {
     sercom->writeDataUART(data);
   } else {
-    // spin lock until a spot opens up in the buffer
-    while(txBuffer.isFull()) {
-      uint8_t interruptsEnabled = ((__get_PRIMASK() & 0x1) == 0);
-
-      if (interruptsEnabled) {
-        uint32_t exceptionNumber = (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk);
-
-        if (exceptionNumber == 0 ||
-              NVIC_GetPriority((IRQn_Type)(exceptionNumber - 16)) > SERCOM_NVIC_PRIORITY) {
-          // no exception or called from an ISR with lower priority,
-          // wait for free buffer spot via IRQ
-          continue;
-        }
-      }
-
-      // interrupts are disabled or called from ISR with higher or equal priority than the SERCOM IRQ
-      // manually call the UART IRQ handler when the data register is empty
-      if (sercom->isDataRegisterEmptyUART()) {
-        IrqHandler();
-      }
-    }
+    waitForTxSpace();
 
     txBuffer.store_char(data);
 
-    sercom->enableDataRegisterEmptyInterruptUART();
+    startTransmit();
   }
 
   return 1;
 }
 
+size_t Uart::write(const uint8_t *buffer, size_t size)
+{
+  size_t written = 0;
+
+  while (written < size) {
+    waitForTxSpace();
+
+    written += txBuffer.write(buffer + written, size - written);
+
+    startTransmit();
+  }
+
+  return written;
+}
+
+void Uart::waitForTxSpace()
+{
+  // spin lock until a spot opens up in the buffer
+  while(txBuffer.isFull()) {
+    uint8_t interruptsEnabled = ((__get_PRIMASK() & 0x1) == 0);
+
+    uint32_t priority = txDmaChannel >= 0 ? DMA_NVIC_PRIORITY : SERCOM_NVIC_PRIORITY;
+
+    if (interruptsEnabled) {
+      uint32_t exceptionNumber = (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk);
+
+      if (exceptionNumber == 0 ||
+            NVIC_GetPriority((IRQn_Type)(exceptionNumber - 16)) > priority) {
+        // no exception or called from an ISR with lower priority,
+        // wait for free buffer spot via IRQ
+        continue;
+      }
+    }
+
+    // interrupts are disabled or called from ISR with higher or equal priority than the SERCOM IRQ
+    // manually call the UART IRQ handler when the data register is empty
+    if (txDmaChannel >= 0) {
+      dmaService();
+    } else if (sercom->isDataRegisterEmptyUART()) {
+      IrqHandler();
+    }
+  }
+}
+
 SercomNumberStopBit Uart::extractNbStopBit(uint16_t config)
 {
   switch(config & HARDSER_STOP_BIT_MASK)
@@ -19,19 +19,20 @@
 #include "Arduino.h"
 #include "wiring_private.h"
 
-#include <string.h>
-
+// Callbacks indexed by EXTINT line, lines without one call nothing() so that
+// the handler needs no check. Single word writes, so attach and detach are atomic.
 static voidFuncPtr ISRcallback[EXTERNAL_NUM_INTERRUPTS];
-static uint32_t    ISRlist[EXTERNAL_NUM_INTERRUPTS];
-static uint32_t    nints; // Stores total number of attached interrupts
 
+static void nothing(void)
+{
+}
 
 /* Configure I/O interrupt sources */
 static void __initialize()
 {
-  memset(ISRlist,     0, sizeof(ISRlist));
-  memset(ISRcallback, 0, sizeof(ISRcallback));
-  nints = 0;
+  for (uint32_t i=0; i<EXTERNAL_NUM_INTERRUPTS; i++) {
+    ISRcallback[i] = nothing;
+  }
 
   NVIC_DisableIRQ(EIC_IRQn);
   NVIC_ClearPendingIRQ(EIC_IRQn);
@@ -84,25 +85,10 @@ void attachInterrupt(uint32_t pin, voidFuncPtr callback, uint32_t mode)
 
   // Only store when there is really an ISR to call.
   // This allow for calling attachInterrupt(pin, NULL, mode), we set up all needed register
-  // but won't service the interrupt, this way we also don't need to check it inside the ISR.
+  // but won't service the interrupt (e.g. wakeup only), the flag is still cleared by the ISR.
   if (callback)
   {
-    // Store interrupts to service in order of when they were attached
-    // to allow for first come first serve handler
-    uint32_t current = 0;
-
-    // Check if we already have this interrupt
-    for (current=0; current<nints; current++) {
-      if (ISRlist[current] == inMask) {
-        break;
-      }
-    }
-    if (current == nints) {
-      // Need to make a new entry
-      nints++;
-    }
-    ISRlist[current] = inMask;       // List of interrupt in order of when they were attached
-    ISRcallback[current] = callback; // List of callback adresses
+    ISRcallback[in] = callback;
 
     // Look for right CONFIG register to be addressed
     if (in > EXTERNAL_INT_7) {
@@ -161,21 +147,8 @@ void detachInterrupt(uint32_t pin)
   // Disable wakeup capability on pin during sleep
   EIC->WAKEUP.reg &= ~inMask;
 
-  // Remove callback from the ISR list
-  uint32_t current;
-  for (current=0; current<nints; current++) {
-    if (ISRlist[current] == inMask) {
-      break;
-    }
-  }
-  if (current == nints) return; // We didn't have it
-
-  // Shift the reminder down
-  for (; current<nints-1; current++) {
-    ISRlist[current]     = ISRlist[current+1];
-    ISRcallback[current] = ISRcallback[current+1];
-  }
-  nints--;
+  // Remove callback, the line is disabled already
+  ISRcallback[in] = nothing;
 }
 
 /*
@@ -183,18 +156,21 @@ void detachInterrupt(uint32_t pin)
  */
 void EIC_Handler(void)
 {
-  // Calling the routine directly from -here- takes about 1us
-  // Depending on where you are in the list it will take longer
+  uint32_t stamp = metricCycleStamp();
 
-  // Loop over all enabled interrupts in the list
-  for (uint32_t i=0; i<nints; i++)
+  // One snapshot of the enabled pending lines, cleared before the callbacks run
+  // so an edge arriving during a callback raises the interrupt again
+  uint32_t pending = EIC->INTFLAG.reg & EIC->INTENSET.reg;
+  EIC->INTFLAG.reg = pending;
+
+  // Lines are dispatched by number, lowest first, independent of attach order
+  while (pending)
   {
-    if ((EIC->INTFLAG.reg & ISRlist[i]) != 0)
-    {
-      // Call the callback function
-      ISRcallback[i]();
-      // Clear the interrupt
-      EIC->INTFLAG.reg = ISRlist[i];
-    }
+    uint32_t line = __builtin_ctz(pending);
+    pending &= pending - 1;
+    ISRcallback[line]();
   }
+
+  metricIncrement(&g_metricEicInterrupts);
+  metricRecord(&g_metricEicIsrCycles, metricCyclesSince(stamp));
 }
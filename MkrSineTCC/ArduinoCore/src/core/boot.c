@@ -0,0 +1,84 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static uint32_t _bootPhaseEndMicros[BOOT_PHASE_COUNT] ;
+static uint32_t _bootPhasesRecorded = 0 ;
+
+static const char *_bootPhaseNames[BOOT_PHASE_COUNT] =
+{
+  "timebase",
+  "constructors",
+  "setupEarly",
+  "init",
+  "usbAttach",
+  "setup",
+  "usbOpen"
+} ;
+
+void bootPhaseEnd( BootPhase phase )
+{
+  if ( phase >= BOOT_PHASE_COUNT || bootPhaseIsRecorded( phase ) )
+  {
+    return ;
+  }
+
+  _bootPhaseEndMicros[phase] = micros() ;
+  _bootPhasesRecorded |= (1ul << phase) ;
+}
+
+int bootPhaseIsRecorded( BootPhase phase )
+{
+  return phase < BOOT_PHASE_COUNT && (_bootPhasesRecorded & (1ul << phase)) != 0 ;
+}
+
+uint32_t bootPhaseEndMicros( BootPhase phase )
+{
+  return bootPhaseIsRecorded( phase ) ? _bootPhaseEndMicros[phase] : 0 ;
+}
+
+uint32_t bootPhaseDurationMicros( BootPhase phase )
+{
+  if ( !bootPhaseIsRecorded( phase ) )
+  {
+    return 0 ;
+  }
+
+  // phases may be skipped, so look for the nearest recorded one
+  for ( int prev = (int)phase - 1 ; prev >= 0 ; prev-- )
+  {
+    if ( bootPhaseIsRecorded( (BootPhase)prev ) )
+    {
+      return _bootPhaseEndMicros[phase] - _bootPhaseEndMicros[prev] ;
+    }
+  }
+
+  return _bootPhaseEndMicros[phase] ;
+}
+
+const char *bootPhaseName( BootPhase phase )
+{
+  return phase < BOOT_PHASE_COUNT ? _bootPhaseNames[phase] : "" ;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -61,9 +61,9 @@ void SERCOM5_Handler  (void) __attribute__ ((weak, alias("Dummy_Handler")));
 void TCC0_Handler     (void) __attribute__ ((weak, alias("Dummy_Handler")));
 void TCC1_Handler     (void) __attribute__ ((weak, alias("Dummy_Handler")));
 void TCC2_Handler     (void) __attribute__ ((weak, alias("Dummy_Handler")));
-void TC3_Handler      (void) __attribute__ ((weak, alias("Dummy_Handler")));
-void TC4_Handler      (void) __attribute__ ((weak, alias("Dummy_Handler")));
-void TC5_Handler      (void) __attribute__ ((weak)); // Used in Tone.cpp
+void TC3_Handler      (void) __attribute__ ((weak)); // Used in Tone.cpp
+void TC4_Handler      (void) __attribute__ ((weak, alias("Dummy_Handler"))); // Used in timebase.c
+void TC5_Handler      (void) __attribute__ ((weak, alias("Dummy_Handler")));
 void TC6_Handler      (void) __attribute__ ((weak, alias("Dummy_Handler")));
 void TC7_Handler      (void) __attribute__ ((weak, alias("Dummy_Handler")));
 void ADC_Handler      (void) __attribute__ ((weak, alias("Dummy_Handler")));
@@ -23,42 +23,15 @@
 extern "C" {
 #endif
 
-/** Tick Counter united by ms */
-static volatile uint32_t _ulTickCount=0 ;
-
 unsigned long millis( void )
 {
-// todo: ensure no interrupts
-  return _ulTickCount ;
+  return (uint32_t)timebaseMillis() ;
 }
 
-// Interrupt-compatible version of micros
-// Theory: repeatedly take readings of SysTick counter, millis counter and SysTick interrupt pending flag.
-// When it appears that millis counter and pending is stable and SysTick hasn't rolled over, use these
-// values to calculate micros. If there is a pending SysTick, add one to the millis counter in the calculation.
+// Interrupt-compatible version of micros, the lower bits of the 64-bit timebase
 unsigned long micros( void )
 {
-  uint32_t ticks, ticks2;
-  uint32_t pend, pend2;
-  uint32_t count, count2;
-
-  ticks2  = SysTick->VAL;
-  pend2   = !!(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)  ;
-  count2  = _ulTickCount ;
-
-  do
-  {
-    ticks=ticks2;
-    pend=pend2;
-    count=count2;
-    ticks2  = SysTick->VAL;
-    pend2   = !!(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)  ;
-    count2  = _ulTickCount ;
-  } while ((pend != pend2) || (count != count2) || (ticks < ticks2));
-
-  return ((count+pend) * 1000) + (((SysTick->LOAD  - ticks)*(1048576/(VARIANT_MCK/1000000)))>>20) ;
-  // this is an optimization to turn a runtime division into two compile-time divisions and
-  // a runtime multiplication and shift, saving a few cycles
+  return (uint32_t)timebaseMicros() ;
 }
 
 void delay( unsigned long ms )
@@ -68,25 +41,28 @@ void delay( unsigned long ms )
     return;
   }
 
-  uint32_t start = micros();
+  uint64_t end = timebaseCycles() + (uint64_t)ms * (VARIANT_MCK / 1000);
+
+  // the compare match cannot wake a handler at or above the timebase
+  // priority from WFI, so only thread mode sleeps and handlers poll
+  int inHandler = (__get_IPSR() != 0);
 
-  while (ms > 0)
+  // sleep until the end or the next interrupt, yield() after each wake-up
+  while (timebaseCycles() < end)
   {
     yield();
-    while (ms > 0 && (micros() - start) >= 1000)
+    if (!inHandler)
     {
-      ms--;
-      start += 1000;
+      timebaseSleepUntil(end);
     }
   }
 }
 
 #include "Reset.h" // for tickReset()
 
+// Only enabled while a reset is pending, time is kept by the timebase
 void SysTick_DefaultHandler(void)
 {
-  // Increment tick count each ms
-  _ulTickCount++;
   tickReset();
 }
 
@@ -0,0 +1,220 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "Arduino.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static DmacDescriptor _descriptors[DMAC_CH_NUM] __attribute__ ((aligned(16))) ;
+static DmacDescriptor _writeback[DMAC_CH_NUM] __attribute__ ((aligned(16))) ;
+
+static DmaCallback _callbacks[DMAC_CH_NUM] ;
+static void *_contexts[DMAC_CH_NUM] ;
+static uint16_t _allocated ;
+
+static void dmaInit( void )
+{
+  PM->AHBMASK.reg |= PM_AHBMASK_DMAC ;
+  PM->APBBMASK.reg |= PM_APBBMASK_DMAC ;
+
+  DMAC->CTRL.reg = 0 ;
+  DMAC->CTRL.reg = DMAC_CTRL_SWRST ;
+  while ( DMAC->CTRL.reg & DMAC_CTRL_SWRST )
+  {
+  }
+
+  DMAC->BASEADDR.reg = (uint32_t)_descriptors ;
+  DMAC->WRBADDR.reg = (uint32_t)_writeback ;
+  DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xF) ;
+
+  NVIC_SetPriority( DMAC_IRQn, DMA_NVIC_PRIORITY ) ;
+  NVIC_EnableIRQ( DMAC_IRQn ) ;
+}
+
+int dmaAllocate( void )
+{
+  int channel = -1 ;
+
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  if ( _allocated == 0 )
+  {
+    dmaInit() ;
+  }
+  for ( int i = 0 ; i < DMAC_CH_NUM ; i++ )
+  {
+    if ( !(_allocated & (1u << i)) )
+    {
+      _allocated |= 1u << i ;
+      channel = i ;
+      break ;
+    }
+  }
+  __set_PRIMASK( primask ) ;
+
+  if ( channel >= 0 )
+  {
+    memset( (void *)&_descriptors[channel], 0, sizeof(DmacDescriptor) ) ;
+    _callbacks[channel] = NULL ;
+
+    // CHID is shared with DMAC_Handler(), so channel registers are accessed with interrupts masked
+    __disable_irq() ;
+    DMAC->CHID.reg = DMAC_CHID_ID( channel ) ;
+    DMAC->CHCTRLA.reg = 0 ;
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST ;
+    __set_PRIMASK( primask ) ;
+  }
+  return channel ;
+}
+
+void dmaFree( int channel )
+{
+  dmaStop( channel ) ;
+
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  _callbacks[channel] = NULL ;
+  _allocated &= ~(1u << channel) ;
+  __set_PRIMASK( primask ) ;
+}
+
+DmacDescriptor *dmaDescriptor( int channel )
+{
+  return &_descriptors[channel] ;
+}
+
+void dmaSetupBlock( DmacDescriptor *descriptor, const volatile void *source, volatile void *destination, uint16_t beats, uint16_t btctrl )
+{
+  uint32_t bytes = (uint32_t)beats << ((btctrl & DMAC_BTCTRL_BEATSIZE_Msk) >> DMAC_BTCTRL_BEATSIZE_Pos) ;
+
+  descriptor->BTCTRL.reg = btctrl | DMAC_BTCTRL_VALID ;
+  descriptor->BTCNT.reg = beats ;
+  descriptor->SRCADDR.reg = (uint32_t)source + ((btctrl & DMAC_BTCTRL_SRCINC) ? bytes : 0) ;
+  descriptor->DSTADDR.reg = (uint32_t)destination + ((btctrl & DMAC_BTCTRL_DSTINC) ? bytes : 0) ;
+}
+
+void dmaConfigure( int channel, uint8_t trigger, uint32_t triggerAction )
+{
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  DMAC->CHID.reg = DMAC_CHID_ID( channel ) ;
+  DMAC->CHCTRLB.reg = DMAC_CHCTRLB_TRIGSRC( trigger ) | triggerAction | DMAC_CHCTRLB_LVL( 0 ) ;
+  __set_PRIMASK( primask ) ;
+}
+
+void dmaSetCallback( int channel, DmaCallback callback, void *context, uint8_t interrupts )
+{
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  _callbacks[channel] = callback ;
+  _contexts[channel] = context ;
+  DMAC->CHID.reg = DMAC_CHID_ID( channel ) ;
+  DMAC->CHINTENCLR.reg = DMAC_CHINTENCLR_MASK ;
+  DMAC->CHINTENSET.reg = interrupts ;
+  __set_PRIMASK( primask ) ;
+}
+
+void dmaStart( int channel )
+{
+  // the write-back descriptor is only written once the DMAC has moved data,
+  // start from a copy so dmaRemaining() is right before the first beat
+  _writeback[channel] = _descriptors[channel] ;
+
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  DMAC->CHID.reg = DMAC_CHID_ID( channel ) ;
+  DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_MASK ;
+  DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE ;
+  __set_PRIMASK( primask ) ;
+}
+
+void dmaStop( int channel )
+{
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  DMAC->CHID.reg = DMAC_CHID_ID( channel ) ;
+  DMAC->CHCTRLA.reg = 0 ;
+  while ( DMAC->CHCTRLA.reg & DMAC_CHCTRLA_ENABLE )
+  {
+  }
+  DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_MASK ;
+  __set_PRIMASK( primask ) ;
+}
+
+int dmaIsBusy( int channel )
+{
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  DMAC->CHID.reg = DMAC_CHID_ID( channel ) ;
+  int busy = (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_ENABLE) != 0 ;
+  __set_PRIMASK( primask ) ;
+  return busy ;
+}
+
+uint16_t dmaRemaining( int channel )
+{
+  // the channel currently moving data has its count in ACTIVE, the others in write-back memory
+  uint32_t active = DMAC->ACTIVE.reg ;
+  if ( (active & DMAC_ACTIVE_ABUSY) && ((active & DMAC_ACTIVE_ID_Msk) >> DMAC_ACTIVE_ID_Pos) == (uint32_t)channel )
+  {
+    return active >> DMAC_ACTIVE_BTCNT_Pos ;
+  }
+  return _writeback[channel].BTCNT.reg ;
+}
+
+void dmaService( void )
+{
+  for ( ;; )
+  {
+    // channel registers are always selected with interrupts masked, so only
+    // the INTPEND access needs to be atomic and callbacks run unmasked
+    uint32_t primask = __get_PRIMASK() ;
+    __disable_irq() ;
+    if ( DMAC->INTSTATUS.reg == 0 )
+    {
+      __set_PRIMASK( primask ) ;
+      return ;
+    }
+    uint16_t pending = DMAC->INTPEND.reg ;
+    uint8_t channel = pending & DMAC_INTPEND_ID_Msk ;
+    uint16_t flags = pending & (DMAC_INTPEND_TERR | DMAC_INTPEND_TCMPL | DMAC_INTPEND_SUSP) ;
+
+    // writing the flags with the channel id clears them
+    DMAC->INTPEND.reg = DMAC_INTPEND_ID( channel ) | flags ;
+    __set_PRIMASK( primask ) ;
+
+    if ( _callbacks[channel] != NULL )
+    {
+      // INTPEND flags are the CHINTFLAG bits shifted by 8
+      _callbacks[channel]( _contexts[channel], flags >> DMAC_INTPEND_TERR_Pos ) ;
+    }
+  }
+}
+
+void DMAC_Handler( void )
+{
+  uint32_t stamp = metricCycleStamp() ;
+
+  dmaService() ;
+
+  metricIncrement( &g_metricDmaInterrupts ) ;
+  metricRecord( &g_metricDmaIsrCycles, metricCyclesSince( stamp ) ) ;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,195 @@
+/*
+  Copyright (c) 2015 Arduino LLC.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "format.h"
+#include <math.h>
+#include <string.h>
+
+const uint32_t g_formatPowersOf10[10] =
+{
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+} ;
+
+static const char _digitPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899" ;
+
+// n / 100 exact for n < 43699 with a 32-bit multiply, beyond that it needs
+// the 64-bit reciprocal which is still cheaper than a library division
+static inline uint32_t divideBy100( uint32_t n )
+{
+  if ( n < 43699 )
+  {
+    return (n * 5243) >> 19 ;
+  }
+  return (uint32_t)(((uint64_t)n * 0x51EB851F) >> 37) ;
+}
+
+extern char* formatDecimal( uint32_t value, char *end )
+{
+  while ( value >= 100 )
+  {
+    uint32_t q = divideBy100( value ) ;
+    const char *pair = &_digitPairs[(value - q * 100) * 2] ;
+    *--end = pair[1] ;
+    *--end = pair[0] ;
+    value = q ;
+  }
+
+  if ( value >= 10 )
+  {
+    *--end = _digitPairs[value * 2 + 1] ;
+    *--end = _digitPairs[value * 2] ;
+  }
+  else
+  {
+    *--end = '0' + value ;
+  }
+  return end ;
+}
+
+extern char* formatBase( uint32_t value, uint8_t base, char *end )
+{
+  if ( base < 2 || base == 10 )
+  {
+    return formatDecimal( value, end ) ;
+  }
+
+  if ( (base & (base - 1)) == 0 )
+  {
+    int shift = 0 ;
+    while ( (1u << shift) < base )
+    {
+      shift++ ;
+    }
+    do
+    {
+      uint32_t c = value & (base - 1) ;
+      *--end = c < 10 ? c + '0' : c + 'A' - 10 ;
+      value >>= shift ;
+    } while ( value ) ;
+    return end ;
+  }
+
+  do
+  {
+    uint32_t c = value % base ;
+    value /= base ;
+    *--end = c < 10 ? c + '0' : c + 'A' - 10 ;
+  } while ( value ) ;
+  return end ;
+}
+
+extern char* formatFraction( uint32_t value, uint8_t digits, char *end )
+{
+  char *start = end - digits ;
+  char *str = formatDecimal( value, end ) ;
+  while ( str > start )
+  {
+    *--str = '0' ;
+  }
+  return str ;
+}
+
+extern char* formatFixed( int32_t value, uint8_t fractionalBits, uint8_t digits, char *end )
+{
+  if ( fractionalBits > 31 ) fractionalBits = 31 ;
+  if ( digits > 9 ) digits = 9 ;
+
+  uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value ;
+  uint32_t integer = magnitude >> fractionalBits ;
+  uint32_t fraction = magnitude & ((1u << fractionalBits) - 1) ;
+
+  // rounded to the requested digits, may carry into the integer part
+  uint32_t scale = g_formatPowersOf10[digits] ;
+  uint64_t half = fractionalBits > 0 ? (1ull << (fractionalBits - 1)) : 0 ;
+  uint32_t decimals = (uint32_t)(((uint64_t)fraction * scale + half) >> fractionalBits) ;
+  if ( decimals >= scale )
+  {
+    decimals -= scale ;
+    integer++ ;
+  }
+
+  char *str = end ;
+  if ( digits > 0 )
+  {
+    str = formatFraction( decimals, digits, str ) ;
+    *--str = '.' ;
+  }
+  str = formatDecimal( integer, str ) ;
+  if ( value < 0 )
+  {
+    *--str = '-' ;
+  }
+  return str ;
+}
+
+static char* formatText( const char *text, char *end )
+{
+  size_t length = strlen( text ) ;
+  end -= length ;
+  memcpy( end, text, length ) ;
+  return end ;
+}
+
+extern char* formatDouble( double number, uint8_t digits, char *end )
+{
+  if ( isnan( number ) ) return formatText( "nan", end ) ;
+  if ( isinf( number ) ) return formatText( "inf", end ) ;
+  if ( number > 4294967040.0 || number < -4294967040.0 ) return formatText( "ovf", end ) ;
+  if ( digits > 9 ) digits = 9 ;
+
+  int negative = number < 0.0 ;
+  if ( negative )
+  {
+    number = -number ;
+  }
+
+  // Round correctly so that 1.999 with 2 digits prints as "2.00"
+  uint32_t scale = g_formatPowersOf10[digits] ;
+  number += 0.5 / scale ;
+
+  // the remainder is scaled to an integer at once instead of digit by digit
+  uint32_t integer = (uint32_t)number ;
+  uint32_t decimals = (uint32_t)((number - (double)integer) * scale) ;
+  if ( decimals >= scale )
+  {
+    decimals = scale - 1 ; // the remainder may round up to 1.0
+  }
+
+  char *str = end ;
+  if ( digits > 0 )
+  {
+    str = formatFraction( decimals, digits, str ) ;
+    *--str = '.' ;
+  }
+  str = formatDecimal( integer, str ) ;
+  if ( negative )
+  {
+    *--str = '-' ;
+  }
+  return str ;
+}
@@ -30,11 +30,23 @@ static void __empty() {
 }
 void yield(void) __attribute__ ((weak, alias("__empty")));
 
+/**
+ * Early setup hook.
+ *
+ * Called by main() right after the timebase is started and the C++ global
+ * constructors have run, before pins, ADC and USB are initialized. Sketches
+ * may redefine it to start time-critical peripherals as soon as possible
+ * after reset. USB is not attached yet, so nothing printed here (e.g. by a
+ * failing expect0()) reaches the host.
+ */
+void setupEarly(void) __attribute__ ((weak, alias("__empty")));
+
 /**
  * SysTick hook
  *
  * This function is called from SysTick handler, before the default
- * handler provided by Arduino.
+ * handler provided by Arduino. The timebase is tickless, so the SysTick
+ * interrupt only runs while a reset is pending (see timebase.h).
  */
 static int __false() {
 	// Return false
@@ -32,19 +32,34 @@ extern "C" void __libc_init_array(void);
  */
 int main( void )
 {
-  init();
+  // the timebase goes first so the following boot phases can be timed
+  initTimebase();
+  bootPhaseEnd(BOOT_PHASE_TIMEBASE);
 
+  // keeps the events recorded before the reset, see trace.h
+  traceInit();
+
+  // global objects are constructed before any sketch code runs, setupEarly() included
   __libc_init_array();
+  bootPhaseEnd(BOOT_PHASE_CONSTRUCTORS);
+
+  // Let the sketch start its time-critical peripherals before anything else
+  setupEarly();
+  bootPhaseEnd(BOOT_PHASE_SETUP_EARLY);
 
+  initPeripherals();
   initVariant();
+  bootPhaseEnd(BOOT_PHASE_INIT);
 
   delay(1);
 #if defined(USBCON)
   USBDevice.init();
   USBDevice.attach();
 #endif
+  bootPhaseEnd(BOOT_PHASE_USB_ATTACH);
 
   setup();
+  bootPhaseEnd(BOOT_PHASE_SETUP);
 
   for (;;)
   {
@@ -0,0 +1,101 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// core metrics, chained at compile time so they are listed without registration
+MetricHistogram g_metricDmaIsrCycles = { { "dmaIsrCycles", METRIC_KIND_HISTOGRAM, 0, 0 }, { 0 } } ;
+Metric g_metricDmaInterrupts = { "dmaInterrupts", METRIC_KIND_COUNTER, &g_metricDmaIsrCycles.metric, 0 } ;
+MetricHistogram g_metricAdcReadCycles = { { "adcReadCycles", METRIC_KIND_HISTOGRAM, &g_metricDmaInterrupts, 0 }, { 0 } } ;
+Metric g_metricAdcReads = { "adcReads", METRIC_KIND_COUNTER, &g_metricAdcReadCycles.metric, 0 } ;
+MetricHistogram g_metricEicIsrCycles = { { "eicIsrCycles", METRIC_KIND_HISTOGRAM, &g_metricAdcReads, 0 }, { 0 } } ;
+Metric g_metricEicInterrupts = { "eicInterrupts", METRIC_KIND_COUNTER, &g_metricEicIsrCycles.metric, 0 } ;
+MetricHistogram g_metricUsbIsrCycles = { { "usbIsrCycles", METRIC_KIND_HISTOGRAM, &g_metricEicInterrupts, 0 }, { 0 } } ;
+Metric g_metricUsbInterrupts = { "usbInterrupts", METRIC_KIND_COUNTER, &g_metricUsbIsrCycles.metric, 0 } ;
+
+static Metric *_metricsHead = &g_metricUsbInterrupts ;
+
+void metricRegister( Metric *metric )
+{
+  for ( Metric *m = _metricsHead ; m != NULL ; m = m->next )
+  {
+    if ( m == metric )
+    {
+      return ;
+    }
+  }
+
+  // append, so metrics are listed in registration order
+  Metric **tail = &_metricsHead ;
+  while ( *tail != NULL )
+  {
+    tail = &(*tail)->next ;
+  }
+  metric->next = NULL ;
+  *tail = metric ;
+}
+
+Metric *metricFirst( void )
+{
+  return _metricsHead ;
+}
+
+void metricSnapshot( Metric *metric, MetricSnapshot *snapshot, int reset )
+{
+  snapshot->name = metric->name ;
+  snapshot->kind = metric->kind ;
+
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+
+  snapshot->value = metric->value ;
+  if ( reset )
+  {
+    metric->value = 0 ;
+  }
+
+  if ( metric->kind == METRIC_KIND_HISTOGRAM )
+  {
+    MetricHistogram *histogram = (MetricHistogram *)metric ;
+    for ( int i = 0 ; i < METRIC_HISTOGRAM_BUCKETS ; i++ )
+    {
+      snapshot->buckets[i] = histogram->buckets[i] ;
+      if ( reset )
+      {
+        histogram->buckets[i] = 0 ;
+      }
+    }
+  }
+
+  __set_PRIMASK( primask ) ;
+}
+
+uint32_t metricBucketLimit( int bucket )
+{
+  if ( bucket < 0 || bucket >= METRIC_HISTOGRAM_BUCKETS - 1 )
+  {
+    return 0 ;
+  }
+  return (uint32_t)METRIC_HISTOGRAM_FIRST_LIMIT << (2 * bucket) ;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,172 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "Arduino.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// x / d for any 32-bit x as a multiplication, M0+ has no divider:
+// MAGIC = ceil(2^SHIFT / d) is exact while its error is below 2^(SHIFT-32)
+#define MICROS_SHIFT 37
+#define MICROS_MAGIC ((1ull << MICROS_SHIFT) / TIMEBASE_CYCLES_PER_MICROSECOND + 1)
+_Static_assert( MICROS_MAGIC < (1ull << 32) &&
+  MICROS_MAGIC * TIMEBASE_CYCLES_PER_MICROSECOND - (1ull << MICROS_SHIFT) < (1ull << (MICROS_SHIFT - 32)),
+  "no exact reciprocal for this F_CPU" ) ;
+#define MILLIS_SHIFT 38
+#define MILLIS_MAGIC 274877907ul // ceil(2^38 / 1000), error 56
+
+// sleeping for less is not worth the wake-up
+#define MIN_SLEEP_CYCLES 200
+
+static volatile uint32_t _wraps ;
+
+// (high * 2^32 + low) / d, the remainders of 2^32 / d and low / d are added up to carry one
+static inline uint64_t divideWide( uint32_t high, uint32_t low, uint32_t d, uint32_t magic, int shift )
+{
+  uint32_t wrapQuotient = (uint32_t)((1ull << 32) / d) ;
+  uint32_t wrapRemainder = (uint32_t)((1ull << 32) % d) ;
+
+  uint32_t extra = high * wrapRemainder ;
+  uint32_t extraQuotient = (uint32_t)(((uint64_t)extra * magic) >> shift) ;
+  uint32_t lowQuotient = (uint32_t)(((uint64_t)low * magic) >> shift) ;
+  uint32_t remainder = (extra - extraQuotient * d) + (low - lowQuotient * d) ;
+
+  return (uint64_t)high * wrapQuotient + extraQuotient + lowQuotient + (remainder >= d ? 1 : 0) ;
+}
+
+void timebaseInit( void )
+{
+  PM->APBCMASK.reg |= PM_APBCMASK_TC4 | PM_APBCMASK_TC5 ;
+
+  GCLK->CLKCTRL.reg = (uint16_t) (GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID( GCM_TC4_TC5 )) ;
+  while ( GCLK->STATUS.bit.SYNCBUSY )
+  {
+  }
+
+  TIMEBASE_TC->COUNT32.CTRLA.reg = TC_CTRLA_SWRST ;
+  while ( TIMEBASE_TC->COUNT32.CTRLA.bit.SWRST )
+  {
+  }
+
+  _wraps = 0 ;
+  TIMEBASE_TC->COUNT32.CTRLA.reg = TC_CTRLA_MODE_COUNT32 | TC_CTRLA_WAVEGEN_NFRQ | TC_CTRLA_PRESCALER_DIV1 ;
+  // keep COUNT synchronized continuously, so reading it needs no request and wait
+  TIMEBASE_TC->COUNT32.READREQ.reg = TC_READREQ_RCONT | TC_READREQ_ADDR( 0x10 ) ;
+  TIMEBASE_TC->COUNT32.INTENSET.reg = TC_INTENSET_OVF ;
+
+  NVIC_SetPriority( TC4_IRQn, (1 << __NVIC_PRIO_BITS) - 1 ) ;
+  NVIC_EnableIRQ( TC4_IRQn ) ;
+
+  TIMEBASE_TC->COUNT32.CTRLA.bit.ENABLE = 1 ;
+  while ( TIMEBASE_TC->COUNT32.STATUS.bit.SYNCBUSY )
+  {
+  }
+}
+
+// Takes a consistent pair of wrap count and counter value.
+static inline uint32_t readCounter( uint32_t *wraps )
+{
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  uint32_t high = _wraps ;
+  uint32_t low = TIMEBASE_TC->COUNT32.COUNT.reg ;
+  // a wrap not handled yet counts if the value was read after it, the
+  // synchronized COUNT may still show the value from before
+  if ( TIMEBASE_TC->COUNT32.INTFLAG.bit.OVF && low < 0x80000000u )
+  {
+    high++ ;
+  }
+  __set_PRIMASK( primask ) ;
+
+  *wraps = high ;
+  return low ;
+}
+
+uint64_t timebaseCycles( void )
+{
+  uint32_t wraps ;
+  uint32_t low = readCounter( &wraps ) ;
+  return ((uint64_t)wraps << 32) | low ;
+}
+
+uint64_t timebaseMicros( void )
+{
+  return timebaseCyclesToMicros( timebaseCycles() ) ;
+}
+
+uint64_t timebaseMillis( void )
+{
+  return timebaseCyclesToMillis( timebaseCycles() ) ;
+}
+
+uint64_t timebaseCyclesToMicros( uint64_t cycles )
+{
+  return divideWide( (uint32_t)(cycles >> 32), (uint32_t)cycles, TIMEBASE_CYCLES_PER_MICROSECOND, MICROS_MAGIC, MICROS_SHIFT ) ;
+}
+
+uint64_t timebaseCyclesToMillis( uint64_t cycles )
+{
+  uint64_t micros = timebaseCyclesToMicros( cycles ) ;
+  return divideWide( (uint32_t)(micros >> 32), (uint32_t)micros, 1000, MILLIS_MAGIC, MILLIS_SHIFT ) ;
+}
+
+void timebaseSleepUntil( uint64_t cycles )
+{
+  // WFI also wakes up on interrupts pending while masked, so the compare
+  // match cannot slip in between the check and the sleep
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  if ( timebaseCycles() + MIN_SLEEP_CYCLES < cycles )
+  {
+    // a wake-up more than one counter wrap away comes early, callers loop anyway
+    TIMEBASE_TC->COUNT32.CC[0].reg = (uint32_t)cycles ;
+    while ( TIMEBASE_TC->COUNT32.STATUS.bit.SYNCBUSY )
+    {
+    }
+    TIMEBASE_TC->COUNT32.INTFLAG.reg = TC_INTFLAG_MC0 ;
+    TIMEBASE_TC->COUNT32.INTENSET.reg = TC_INTENSET_MC0 ;
+    __DSB() ;
+    __WFI() ;
+  }
+  __set_PRIMASK( primask ) ;
+}
+
+void TC4_Handler( void )
+{
+  uint8_t flags = TIMEBASE_TC->COUNT32.INTFLAG.reg ;
+
+  if ( flags & TC_INTFLAG_OVF )
+  {
+    // readers in higher priority interrupts must not see the flag cleared
+    // before the wrap is counted
+    uint32_t primask = __get_PRIMASK() ;
+    __disable_irq() ;
+    TIMEBASE_TC->COUNT32.INTFLAG.reg = TC_INTFLAG_OVF ;
+    _wraps++ ;
+    __set_PRIMASK( primask ) ;
+  }
+  if ( flags & TC_INTFLAG_MC0 )
+  {
+    // wake-up of timebaseSleepUntil(), nothing else to do
+    TIMEBASE_TC->COUNT32.INTENCLR.reg = TC_INTENCLR_MC0 ;
+    TIMEBASE_TC->COUNT32.INTFLAG.reg = TC_INTFLAG_MC0 ;
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
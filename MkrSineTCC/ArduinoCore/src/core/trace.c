@@ -0,0 +1,99 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Arduino.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_MAGIC 0x54726345 // "TrcE"
+
+typedef struct
+{
+  uint32_t magic ;
+  volatile uint32_t head ; // records written since cleared
+  volatile uint32_t frozen ;
+  TraceRecord records[TRACE_CAPACITY] ;
+} TraceBuffer ;
+
+// not cleared by the startup code, see .noinit in the linker scripts
+static TraceBuffer _trace __attribute__ ((section(".noinit"))) ;
+
+void traceEvent( uint8_t event, uint32_t arg )
+{
+  // the raw stamp keeps the record cheap, the host converts it
+  uint32_t time = timebaseCycles32() ;
+  uint32_t eventAndArg = ((uint32_t)event << 24) | (arg & 0xFFFFFF) ;
+
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  if ( !_trace.frozen )
+  {
+    TraceRecord *record = &_trace.records[_trace.head++ & (TRACE_CAPACITY - 1)] ;
+    record->time = time ;
+    record->eventAndArg = eventAndArg ;
+  }
+  __set_PRIMASK( primask ) ;
+}
+
+void traceInit( void )
+{
+  if ( _trace.magic != TRACE_MAGIC )
+  {
+    // power-on, RAM content is random
+    _trace.magic = TRACE_MAGIC ;
+    _trace.head = 0 ;
+    _trace.frozen = 0 ;
+  }
+
+  traceEvent( TRACE_EVENT_RESET, PM->RCAUSE.reg ) ;
+}
+
+void traceFreeze( void )
+{
+  _trace.frozen = 1 ;
+}
+
+int traceIsFrozen( void )
+{
+  return _trace.frozen != 0 ;
+}
+
+void traceResume( void )
+{
+  uint32_t primask = __get_PRIMASK() ;
+  __disable_irq() ;
+  _trace.head = 0 ;
+  _trace.frozen = 0 ;
+  __set_PRIMASK( primask ) ;
+}
+
+uint32_t traceCount( void )
+{
+  return _trace.head ;
+}
+
+const TraceRecord *traceRecord( uint32_t index )
+{
+  uint32_t head = _trace.head ;
+  uint32_t first = head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0 ;
+  return &_trace.records[(first + index) & (TRACE_CAPACITY - 1)] ;
+}
+
+#ifdef __cplusplus
+}
+#endif
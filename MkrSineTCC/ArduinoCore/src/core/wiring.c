@@ -56,6 +56,12 @@ void calibrateADC()
  *   - During reset, all PORT lines are configured as inputs with input buffers, output buffers and pull disabled.
  */
 void init( void )
+{
+  initTimebase();
+  initPeripherals();
+}
+
+void initTimebase( void )
 {
   // Set Systick to 1ms interval, common to all Cortex-M variants
   if ( SysTick_Config( SystemCoreClock / 1000 ) )
@@ -65,6 +71,15 @@ void init( void )
   }
   NVIC_SetPriority (SysTick_IRQn,  (1 << __NVIC_PRIO_BITS) - 2);  /* set Priority for Systick Interrupt (2nd lowest) */
 
+  // Tickless, the counter keeps running for cycle stamps, see timebase.h
+  SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+
+  timebaseInit();
+}
+
+void initPeripherals( void )
+{
+
   // Clock PORT for Digital I/O
 //  PM->APBBMASK.reg |= PM_APBBMASK_PORT ;
 //
@@ -86,6 +101,12 @@ void init( void )
   // Setup all pins (digital and analog) in INPUT mode (default is nothing)
   for (uint32_t ul = 0 ; ul < NUM_DIGITAL_PINS ; ul++ )
   {
+    // Keep pins already given to a peripheral (by setupEarly() hook)
+    if ( g_APinDescription[ul].ulPinType != PIO_NOT_A_PIN &&
+         PORT->Group[g_APinDescription[ul].ulPort].PINCFG[g_APinDescription[ul].ulPin].bit.PMUXEN )
+    {
+      continue ;
+    }
     pinMode( ul, INPUT ) ;
   }
 #endif
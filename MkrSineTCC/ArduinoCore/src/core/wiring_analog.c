@@ -127,6 +127,7 @@ void analogReference(eAnalogReference mode)
 
 uint32_t analogRead(uint32_t pin)
 {
+  uint32_t stamp = metricCycleStamp();
   uint32_t valueRead = 0;
 
   if (pin < A0) {
@@ -183,6 +184,9 @@ uint32_t analogRead(uint32_t pin)
   ADC->CTRLA.bit.ENABLE = 0x00;             // Disable ADC
   syncADC();
 
+  metricIncrement(&g_metricAdcReads);
+  metricRecord(&g_metricAdcReadCycles, metricCyclesSince(stamp));
+
   return mapResolution(valueRead, _ADCResolution, _readResolution);
 }
 
@@ -214,7 +218,9 @@ void analogWrite(uint32_t pin, uint32_t value)
     return;
   }
 
-  if ((attr & PIN_ATTR_PWM) == PIN_ATTR_PWM)
+  // TC4 and TC5 run the timebase, see timebase.h
+  if ((attr & PIN_ATTR_PWM) == PIN_ATTR_PWM &&
+      GetTC(pinDesc.ulPWMChannel) != TC4 && GetTC(pinDesc.ulPWMChannel) != TC5)
   {
     value = mapResolution(value, _writeResolution, 16);
 
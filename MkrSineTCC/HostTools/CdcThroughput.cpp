@@ -0,0 +1,122 @@
+/*
+ * CdcThroughput.cpp
+ *
+ * Host side of runCdcThroughputTest() in MkrUtil.cpp: asks the board to stream
+ * a counting pattern over USB CDC, verifies it and prints sustained MB/s.
+ *
+ * Build (Linux/macOS): g++ -O2 -o CdcThroughput CdcThroughput.cpp
+ * Usage:               ./CdcThroughput /dev/ttyACM0 [runs]
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int openPort(const char *path)
+{
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if(fd < 0) return -1;
+
+  struct termios tio;
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 20; // 2s read timeout
+  tcsetattr(fd, TCSANOW, &tio);
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+// Reads exactly size bytes, returns false on timeout.
+static bool readAll(int fd, uint8_t *buf, size_t size)
+{
+  while(size > 0) {
+    ssize_t n = read(fd, buf, size);
+    if(n <= 0) return false;
+    buf += n;
+    size -= n;
+  }
+  return true;
+}
+
+// Skips status lines until the "THRU" header.
+static bool waitHeader(int fd)
+{
+  const char *magic = "THRU";
+  int matched = 0;
+  uint8_t c;
+  while(matched < 4) {
+    if(!readAll(fd, &c, 1)) return false;
+    if(c == magic[matched]) matched++;
+    else matched = (c == magic[0]) ? 1 : 0;
+  }
+  return true;
+}
+
+static int runOnce(int fd)
+{
+  if(write(fd, "T", 1) != 1) return 1;
+  if(!waitHeader(fd)) {
+    fprintf(stderr, "no response\n");
+    return 1;
+  }
+
+  uint8_t lengthBytes[4];
+  if(!readAll(fd, lengthBytes, 4)) return 1;
+  uint32_t length = lengthBytes[0] | (lengthBytes[1] << 8) |
+    (lengthBytes[2] << 16) | ((uint32_t)lengthBytes[3] << 24);
+
+  static uint8_t buf[64 * 1024];
+  uint32_t received = 0, errors = 0;
+  double start = nowSeconds();
+  while(received < length) {
+    size_t chunk = length - received;
+    if(chunk > sizeof(buf)) chunk = sizeof(buf);
+    ssize_t n = read(fd, buf, chunk);
+    if(n <= 0) {
+      fprintf(stderr, "timeout after %u of %u bytes\n", received, length);
+      return 1;
+    }
+    for(ssize_t i = 0; i < n; i++)
+      if(buf[i] != (uint8_t)(received + i)) errors++;
+    received += n;
+  }
+  double seconds = nowSeconds() - start;
+
+  printf("%u bytes in %.3f s: %.3f MB/s, %u pattern errors\n",
+    received, seconds, received / seconds / 1e6, errors);
+  return errors != 0;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 2) {
+    fprintf(stderr, "usage: %s <tty> [runs]\n", argv[0]);
+    return 2;
+  }
+  int runs = (argc > 2) ? atoi(argv[2]) : 3;
+
+  int fd = openPort(argv[1]);
+  if(fd < 0) {
+    perror(argv[1]);
+    return 2;
+  }
+
+  int rc = 0;
+  for(int i = 0; i < runs; i++) rc |= runOnce(fd);
+
+  close(fd);
+  return rc;
+}
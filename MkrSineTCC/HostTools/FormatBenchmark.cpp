@@ -0,0 +1,166 @@
+/*
+ * FormatBenchmark.cpp
+ *
+ * Host check and micro-benchmark of the number formatting in ArduinoCore
+ * format.c against the digit loops Print.cpp used before. The results are
+ * compared with snprintf first. Host CPUs have hardware dividers, so the
+ * speedup here understates the one on the Cortex-M0+; the on-target cycle
+ * counts come from runPrintBenchmark() in MkrUtil.cpp.
+ *
+ * Build: g++ -O2 -I../ArduinoCore/include/core -o FormatBenchmark \
+ *          FormatBenchmark.cpp ../ArduinoCore/src/core/format.c
+ * Usage: ./FormatBenchmark
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "format.h"
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Print::printNumber() before format.c, base passed at runtime as in Print
+static int referenceNumber(unsigned long n, uint8_t base, char *out)
+{
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while(n);
+  int len = (int)(&buf[sizeof(buf) - 1] - str);
+  memcpy(out, str, len);
+  return len;
+}
+
+// Print::printFloat() before format.c, for non-negative numbers
+static int referenceFloat(double number, uint8_t digits, char *out)
+{
+  double rounding = 0.5;
+  for (uint8_t i=0; i<digits; ++i)
+    rounding /= 10.0;
+  number += rounding;
+
+  unsigned long int_part = (unsigned long)number;
+  double remainder = number - (double)int_part;
+  int len = referenceNumber(int_part, 10, out);
+  if (digits > 0) out[len++] = '.';
+  while (digits-- > 0) {
+    remainder *= 10.0;
+    unsigned int toPrint = (unsigned int)(remainder);
+    len += referenceNumber(toPrint, 10, out + len);
+    remainder -= toPrint;
+  }
+  return len;
+}
+
+static int format(uint32_t value, uint8_t base, char *out)
+{
+  char buf[FORMAT_BUFFER_SIZE];
+  char *end = &buf[sizeof(buf)];
+  char *str = formatBase(value, base, end);
+  memcpy(out, str, end - str);
+  return (int)(end - str);
+}
+
+static int fixed(int32_t value, uint8_t bits, uint8_t digits, char *out)
+{
+  char buf[FORMAT_BUFFER_SIZE];
+  char *end = &buf[sizeof(buf)];
+  char *str = formatFixed(value, bits, digits, end);
+  memcpy(out, str, end - str);
+  return (int)(end - str);
+}
+
+static uint32_t randomValue()
+{
+  // spread over all magnitudes, not only 10-digit numbers
+  uint32_t r = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+  return r >> (rand() % 32);
+}
+
+static int check()
+{
+  int errors = 0;
+  char a[64], b[64];
+  for(int i = 0; i < 1000000; i++) {
+    uint32_t v = i < 1000 ? i : (i < 2000 ? 0xFFFFFFFFu - i : randomValue());
+    const uint8_t bases[] = { 10, 16, 8 };
+    const char *formats[] = { "%u", "%X", "%o" };
+    for(int k = 0; k < 3; k++) {
+      int n = format(v, bases[k], a);
+      a[n] = 0;
+      snprintf(b, sizeof(b), formats[k], v);
+      if(strcmp(a, b) != 0 && errors++ < 10) printf("base %d: %s != %s\n", bases[k], a, b);
+    }
+    int n = format(v, 2, a);
+    a[n] = 0;
+    b[referenceNumber(v, 2, b)] = 0;
+    if(strcmp(a, b) != 0 && errors++ < 10) printf("base 2: %s != %s\n", a, b);
+
+    // fixed-point against correctly rounded doubles, ties may round either way
+    int32_t q = (int32_t)((uint32_t)rand() << 16 ^ (uint32_t)rand());
+    uint8_t bits = rand() % 32, digits = rand() % 10;
+    n = fixed(q, bits, digits, a);
+    a[n] = 0;
+    double exact = ldexp((double)q, -bits);
+    snprintf(b, sizeof(b), "%.*f", digits, exact);
+    if(strcmp(a, b) != 0) {
+      double scaled = fabs(exact) * pow(10, digits);
+      bool tie = fabs(scaled - floor(scaled) - 0.5) < 1e-6;
+      bool negativeZero = strcmp(a + 1, b) == 0 && a[0] == '-';
+      if(!tie && !negativeZero && errors++ < 10) printf("fixed %d/%d/%d: %s != %s\n", q, bits, digits, a, b);
+    }
+  }
+  return errors;
+}
+
+template<typename F> static double measure(F f, int iterations)
+{
+  double start = nowSeconds();
+  for(int i = 0; i < iterations; i++) f(i);
+  return (nowSeconds() - start) * 1e9 / iterations;
+}
+
+int main()
+{
+  int errors = check();
+  printf("check: %d errors\n", errors);
+
+  enum { count = 4096, iterations = 10000000 };
+  static uint32_t values[count];
+  static int32_t fixedValues[count];
+  static double doubles[count];
+  for(int i = 0; i < count; i++) {
+    values[i] = randomValue();
+    fixedValues[i] = (int32_t)(randomValue() & 0x7FFFFFFF);
+    doubles[i] = fixedValues[i] / 65536.0;
+  }
+
+  volatile uint8_t base10 = 10, base16 = 16; // runtime bases as in Print
+  char out[64];
+  volatile int sink = 0;
+  double refDec = measure([&](int i) { sink += referenceNumber(values[i % count], base10, out); }, iterations);
+  double newDec = measure([&](int i) { sink += format(values[i % count], base10, out); }, iterations);
+  double refHex = measure([&](int i) { sink += referenceNumber(values[i % count], base16, out); }, iterations);
+  double newHex = measure([&](int i) { sink += format(values[i % count], base16, out); }, iterations);
+  double refFloat = measure([&](int i) { sink += referenceFloat(doubles[i % count], 2, out); }, iterations);
+  double newFixed = measure([&](int i) { sink += fixed(fixedValues[i % count], 16, 2, out); }, iterations);
+
+  printf("decimal:  old %6.1f ns  new %6.1f ns\n", refDec, newDec);
+  printf("hex:      old %6.1f ns  new %6.1f ns\n", refHex, newHex);
+  printf("2 digits: old printFloat %6.1f ns  new printFixed Q16 %6.1f ns\n", refFloat, newFixed);
+  return errors != 0;
+}
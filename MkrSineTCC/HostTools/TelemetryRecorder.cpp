@@ -0,0 +1,234 @@
+/*
+ * TelemetryRecorder.cpp
+ *
+ * Host side of MkrTelemetry.cpp: decodes the COBS-framed binary telemetry
+ * stream from SerialUSB, checks sequence numbers and CRCs and appends each
+ * record type as rows of a separate CSV file in the output directory:
+ *   chopper.csv  counters.csv  samples.csv
+ *
+ * Build (Linux/macOS): g++ -O2 -o TelemetryRecorder TelemetryRecorder.cpp
+ * Usage:               ./TelemetryRecorder /dev/ttyACM0 [outdir] [seconds]
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TELEMETRY_HOST_ONLY
+#include "../MkrSineTCC/src/MkrTelemetry.h"
+
+static volatile bool _stop = false;
+
+static void handleSignal(int)
+{
+  _stop = true;
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int openPort(const char *path)
+{
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if(fd < 0) return -1;
+
+  struct termios tio;
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 5; // 0.5s read timeout to check for stop
+  tcsetattr(fd, TCSANOW, &tio);
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+// same as computeCrc32() in MkrUtil.cpp
+static uint32_t computeCrc32(uint32_t crc, const uint8_t *p, int size)
+{
+  crc = ~crc;
+  while(size-- > 0) {
+    crc ^= *p++;
+    for(int i = 0; i < 8; i++)
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+// Decodes a COBS block without delimiters, returns the decoded size or -1.
+static int decodeCobs(const uint8_t *src, int size, uint8_t *dst)
+{
+  int n = 0;
+  int i = 0;
+  while(i < size) {
+    uint8_t code = src[i++];
+    if(code == 0 || i + code - 1 > size) return -1;
+    for(int k = 1; k < code; k++) dst[n++] = src[i++];
+    if(code != 0xFF && i < size) dst[n++] = 0;
+  }
+  return n;
+}
+
+static uint16_t get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t get32(const uint8_t *p) { return get16(p) | ((uint32_t)get16(p + 2) << 16); }
+
+struct Recorder {
+  FILE *chopper;
+  FILE *counters;
+  FILE *samples;
+  double startSeconds;
+  bool haveSequence;
+  uint16_t nextSequence;
+  uint32_t frames, badFrames, lostFrames, records;
+};
+
+static FILE *openCsv(const char *dir, const char *name, const char *header)
+{
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  FILE *f = fopen(path, "w");
+  if(!f) {
+    perror(path);
+    exit(2);
+  }
+  fprintf(f, "%s\n", header);
+  return f;
+}
+
+static void writeRecord(struct Recorder *r, double t, uint16_t seq, int type, const uint8_t *p, int size)
+{
+  r->records++;
+  switch(type) {
+  case TELEMETRY_CHOPPER_STATE: {
+    if(size < (int)sizeof(struct TelemetryChopperState)) break;
+    const struct TelemetryChopperState *s = (const struct TelemetryChopperState *)p;
+    int chops = s->chopsPerHalfCycle;
+    if(size < (int)(sizeof(*s) + chops * sizeof(uint32_t))) break;
+    fprintf(r->chopper, "%.6f,%u,%d,%d,%u,%d,%u,%u,%u,", t, seq, (int)s->cycleMicroseconds,
+      s->dutyCycle1024, s->enabled, chops, s->numClocksPerHalfCycle, s->chopTopValue, s->callbackCounter);
+    for(int i = 0; i < chops; i++)
+      fprintf(r->chopper, "%s%u", i ? " " : "", get32(p + sizeof(*s) + i * 4));
+    fprintf(r->chopper, "\n");
+    break;
+  }
+  case TELEMETRY_COUNTERS: {
+    if(size < (int)sizeof(struct TelemetryCounters)) break;
+    const struct TelemetryCounters *c = (const struct TelemetryCounters *)p;
+    fprintf(r->counters, "%.6f,%u,%u,%u,%u\n", t, seq, c->loopCount, c->cycleEnds, c->droppedFrames);
+    break;
+  }
+  case TELEMETRY_SAMPLES: {
+    if(size < (int)sizeof(struct TelemetrySamples)) break;
+    const struct TelemetrySamples *s = (const struct TelemetrySamples *)p;
+    if(size < (int)(sizeof(*s) + s->count * sizeof(int16_t))) break;
+    for(int i = 0; i < s->count; i++)
+      fprintf(r->samples, "%.6f,%u,%u,%u,%d\n", t, seq, s->channel, s->firstIndex + i,
+        (int16_t)get16(p + sizeof(*s) + i * 2));
+    break;
+  }
+  default:
+    r->records--; // unknown type, skipped
+    break;
+  }
+}
+
+static void handleFrame(struct Recorder *r, const uint8_t *encoded, int encodedSize)
+{
+  if(encodedSize == 0) return; // back-to-back delimiters
+
+  uint8_t frame[1024];
+  int size = (encodedSize <= (int)sizeof(frame)) ? decodeCobs(encoded, encodedSize, frame) : -1;
+  if(size < 6 || computeCrc32(0, frame, size - 4) != get32(frame + size - 4)) {
+    r->badFrames++; // also text output between frames
+    return;
+  }
+
+  uint16_t seq = get16(frame);
+  if(r->haveSequence && seq != r->nextSequence)
+    r->lostFrames += (uint16_t)(seq - r->nextSequence);
+  r->haveSequence = true;
+  r->nextSequence = seq + 1;
+  r->frames++;
+
+  double t = nowSeconds() - r->startSeconds;
+  int i = 2;
+  while(i + 2 <= size - 4) {
+    int type = frame[i];
+    int length = frame[i + 1];
+    if(i + 2 + length > size - 4) break;
+    writeRecord(r, t, seq, type, frame + i + 2, length);
+    i += 2 + length;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 2) {
+    fprintf(stderr, "usage: %s <tty> [outdir] [seconds]\n", argv[0]);
+    return 2;
+  }
+  const char *dir = (argc > 2) ? argv[2] : ".";
+  double seconds = (argc > 3) ? atof(argv[3]) : 0;
+
+  int fd = openPort(argv[1]);
+  if(fd < 0) {
+    perror(argv[1]);
+    return 2;
+  }
+  signal(SIGINT, handleSignal);
+
+  struct Recorder r;
+  memset(&r, 0, sizeof(r));
+  r.chopper = openCsv(dir, "chopper.csv", "time,seq,cycleMicroseconds,dutyCycle1024,enabled,"
+    "chopsPerHalfCycle,numClocksPerHalfCycle,chopTopValue,callbackCounter,chopMatchValues");
+  r.counters = openCsv(dir, "counters.csv", "time,seq,loopCount,cycleEnds,droppedFrames");
+  r.samples = openCsv(dir, "samples.csv", "time,seq,channel,index,value");
+  r.startSeconds = nowSeconds();
+
+  static uint8_t block[4096];
+  int blockSize = 0;
+  bool overflow = false;
+  double lastReport = r.startSeconds;
+  while(!_stop) {
+    uint8_t buf[4096];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if(n < 0) break;
+
+    for(ssize_t i = 0; i < n; i++) {
+      if(buf[i] == 0) {
+        if(overflow) r.badFrames++;
+        else handleFrame(&r, block, blockSize);
+        blockSize = 0;
+        overflow = false;
+      }
+      else if(blockSize < (int)sizeof(block)) block[blockSize++] = buf[i];
+      else overflow = true;
+    }
+
+    double now = nowSeconds();
+    if(now - lastReport >= 1) {
+      fprintf(stderr, "\rframes=%u records=%u lost=%u bad=%u", r.frames, r.records, r.lostFrames, r.badFrames);
+      fflush(r.chopper);
+      fflush(r.counters);
+      fflush(r.samples);
+      lastReport = now;
+    }
+    if(seconds > 0 && now - r.startSeconds >= seconds) break;
+  }
+  fprintf(stderr, "\rframes=%u records=%u lost=%u bad=%u\n", r.frames, r.records, r.lostFrames, r.badFrames);
+
+  fclose(r.chopper);
+  fclose(r.counters);
+  fclose(r.samples);
+  close(fd);
+  return 0;
+}
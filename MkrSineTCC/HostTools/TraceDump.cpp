@@ -0,0 +1,174 @@
+/*
+ * TraceDump.cpp
+ *
+ * Host side of dumpTrace() in MkrUtil.cpp: requests the trace buffer over
+ * USB CDC and prints it as a timeline, oldest event first. The raw blob may
+ * be saved and decoded again later.
+ *
+ * Build (Linux/macOS): g++ -O2 -o TraceDump TraceDump.cpp
+ * Usage:               ./TraceDump /dev/ttyACM0 [save.bin]
+ *                      ./TraceDump -f saved.bin
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+// CPU clock the timestamps are counted in, F_CPU of the firmware
+#define CPU_CYCLES_PER_MICROSECOND 48
+
+// event ids of trace.h and MkrSineChopperTcc.h
+static const char *eventName(int event)
+{
+  switch(event) {
+  case 0x01: return "reset";
+  case 0x02: return "usbInterrupt";
+  case 0x03: return "panic";
+  case 0x40: return "chopperStart";
+  case 0x41: return "chopperStop";
+  case 0x42: return "chopIndex";
+  case 0x43: return "compareWrite";
+  case 0x44: return "outputShutdown";
+  case 0x45: return "overCurrentTrip";
+  default: return "?";
+  }
+}
+
+static int openPort(const char *path)
+{
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if(fd < 0) return -1;
+
+  struct termios tio;
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 20; // 2s read timeout
+  tcsetattr(fd, TCSANOW, &tio);
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+// Reads exactly size bytes, returns false on timeout or end of file.
+static bool readAll(int fd, uint8_t *buf, size_t size)
+{
+  while(size > 0) {
+    ssize_t n = read(fd, buf, size);
+    if(n <= 0) return false;
+    buf += n;
+    size -= n;
+  }
+  return true;
+}
+
+// Skips other output until the "TRCE" header.
+static bool waitHeader(int fd)
+{
+  const char *magic = "TRCE";
+  int matched = 0;
+  uint8_t c;
+  while(matched < 4) {
+    if(!readAll(fd, &c, 1)) return false;
+    if(c == magic[matched]) matched++;
+    else matched = (c == magic[0]) ? 1 : 0;
+  }
+  return true;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void printTimeline(const uint8_t *records, uint32_t count)
+{
+  // timestamps are 32-bit CPU cycle counts, unwrapped here until the next reset
+  uint64_t base = 0;
+  uint64_t previous = 0;
+  bool first = true;
+  for(uint32_t i = 0; i < count; i++) {
+    uint32_t time = get32(records + i * 8);
+    uint32_t eventAndArg = get32(records + i * 8 + 4);
+    int event = eventAndArg >> 24;
+    uint32_t arg = eventAndArg & 0xFFFFFF;
+
+    if(event == 0x01) {
+      printf("---- reset, cause 0x%02x ----\n", arg);
+      base = 0;
+      first = true;
+    }
+
+    uint64_t cycles = base + time;
+    if(!first && cycles < previous) {
+      base += 1ull << 32;
+      cycles += 1ull << 32;
+    }
+    uint64_t us = cycles / CPU_CYCLES_PER_MICROSECOND;
+
+    long long delta = first ? 0 : (long long)((cycles - previous) / CPU_CYCLES_PER_MICROSECOND);
+    printf("%6u %12.3f ms %+10lld us  %-14s 0x%06x (%u)\n",
+      i, us / 1000.0, delta, eventName(event), arg, arg);
+    previous = cycles;
+    first = false;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  bool fromFile = argc > 2 && strcmp(argv[1], "-f") == 0;
+  if(argc < 2 || (strcmp(argv[1], "-f") == 0 && !fromFile)) {
+    fprintf(stderr, "usage: %s <tty> [save.bin] | -f <saved.bin>\n", argv[0]);
+    return 2;
+  }
+
+  const char *path = fromFile ? argv[2] : argv[1];
+  int fd = fromFile ? open(path, O_RDONLY) : openPort(path);
+  if(fd < 0) {
+    perror(path);
+    return 2;
+  }
+
+  if(!fromFile && write(fd, "D", 1) != 1) return 1;
+  if(!waitHeader(fd)) {
+    fprintf(stderr, "no trace header\n");
+    return 1;
+  }
+
+  uint8_t header[12];
+  if(!readAll(fd, header, sizeof(header))) return 1;
+  uint32_t count = get32(header);
+  uint32_t total = get32(header + 4);
+  uint32_t frozen = get32(header + 8);
+  if(count > 65536) {
+    fprintf(stderr, "bad record count %u\n", count);
+    return 1;
+  }
+
+  uint8_t *records = (uint8_t *)malloc(count * 8 + 1);
+  if(!readAll(fd, records, count * 8)) {
+    fprintf(stderr, "truncated trace\n");
+    return 1;
+  }
+  close(fd);
+
+  if(!fromFile && argc > 2) {
+    FILE *f = fopen(argv[2], "wb");
+    if(!f) {
+      perror(argv[2]);
+      return 2;
+    }
+    fwrite("TRCE", 1, 4, f);
+    fwrite(header, 1, sizeof(header), f);
+    fwrite(records, 8, count, f);
+    fclose(f);
+  }
+
+  printf("%u of %u records%s\n", count, total, frozen ? ", frozen (panic)" : "");
+  printTimeline(records, count);
+  free(records);
+  return 0;
+}
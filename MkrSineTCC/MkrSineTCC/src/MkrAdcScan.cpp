@@ -0,0 +1,252 @@
+/*
+ * MkrAdcScan.cpp
+ *
+ * Created: 19.10.2026 16:41:09
+ * Author: SL
+ */
+
+#include <Arduino.h>
+
+#include "adc\adc.h"
+
+#include "MkrAdcScan.h"
+#include "MkrUtil.h"
+
+// global single instance
+__MkrAdcScan MkrAdcScan;
+
+static struct adc_module _adc;
+static int _dmaChannel = -1;
+static bool _twelveBits;
+static int _accumulateLog2;
+static int _averagingShift;
+
+// the channel descriptor fills the first half and links to this one for the second
+static DmacDescriptor _secondHalfDescriptor __attribute__ ((aligned(16)));
+
+static int16_t *_buffer;
+static int _samplesPerHalf;
+static int _framesPerHalf;
+static void (*_halfCallback)(const int16_t *samples, int frames);
+
+static volatile uint32_t _halvesCompleted;
+static uint32_t _halvesConsumed;
+static uint32_t _overruns;
+static bool _windowEnabled; // the window event may feed an over-current trip
+
+static void halfCompleteCallback(void *context, uint8_t flags);
+
+int __MkrAdcScan::start(int firstInput, int numInputs, int16_t *buffer, int framesPerHalf,
+  void (*halfCallback)(const int16_t *samples, int frames), bool twelveBits)
+{
+  if(numInputs < 1 || numInputs > ADC_SCAN_MAX_INPUTS) return 1;
+  if(firstInput < 0 || firstInput + numInputs > ADC_SCAN_MAX_INPUTS + 4) return 1; // AIN0..19
+  if(framesPerHalf < 1 || framesPerHalf * numInputs > 0xffff) return 1;
+
+  if(stop() != 0) return 1;
+
+  // another owner of the ADC, e.g. MkrSineChopperTcc.setBusCompensation()
+  if(ADC->CTRLA.reg & ADC_CTRLA_ENABLE) return 1;
+
+  struct adc_config config;
+  adc_get_config_defaults(&config);
+  config.clock_source = GCLK_GENERATOR_3; // 8 MHz OSC8M
+  config.clock_prescaler = ADC_CLOCK_PRESCALER_DIV4;
+  config.resolution = twelveBits ? ADC_RESOLUTION_12BIT : ADC_RESOLUTION_10BIT;
+  if(_accumulateLog2 > 0) {
+    config.resolution = ADC_RESOLUTION_CUSTOM;
+    config.accumulate_samples = (enum adc_accumulate_samples)ADC_AVGCTRL_SAMPLENUM(_accumulateLog2);
+    config.divide_result = (enum adc_divide_result)_averagingShift;
+  }
+  config.reference = ADC_REFERENCE_INTVCC1; // VDDANA/2 with gain 1/2, as analogRead() AR_DEFAULT
+  config.gain_factor = ADC_GAIN_FACTOR_DIV2;
+  config.positive_input = (enum adc_positive_input)firstInput;
+  config.negative_input = ADC_NEGATIVE_INPUT_GND;
+  config.sample_length = 0;
+  config.freerunning = true;
+  config.pin_scan.offset_start_scan = 0;
+  config.pin_scan.inputs_to_scan = numInputs > 1 ? numInputs : 0;
+  if(adc_init(&_adc, ADC, &config) != STATUS_OK) return 1;
+
+  if(_dmaChannel < 0) {
+    _dmaChannel = dmaAllocate();
+    if(_dmaChannel < 0) return 1;
+  }
+
+  _buffer = buffer;
+  _framesPerHalf = framesPerHalf;
+  _samplesPerHalf = framesPerHalf * numInputs;
+  _halfCallback = halfCallback;
+  _twelveBits = twelveBits;
+  _halvesCompleted = 0;
+  _halvesConsumed = 0;
+  _overruns = 0;
+
+  // two linked blocks in circles, an interrupt at the end of each
+  uint16_t btctrl = DMAC_BTCTRL_BEATSIZE_HWORD | DMAC_BTCTRL_DSTINC | DMAC_BTCTRL_BLOCKACT_INT;
+  DmacDescriptor *firstHalf = dmaDescriptor(_dmaChannel);
+  dmaSetupBlock(firstHalf, &ADC->RESULT.reg, buffer, _samplesPerHalf, btctrl);
+  dmaSetupBlock(&_secondHalfDescriptor, &ADC->RESULT.reg, buffer + _samplesPerHalf, _samplesPerHalf, btctrl);
+  firstHalf->DESCADDR.reg = (uint32_t)&_secondHalfDescriptor;
+  _secondHalfDescriptor.DESCADDR.reg = (uint32_t)firstHalf;
+
+  dmaConfigure(_dmaChannel, ADC_DMAC_ID_RESRDY, DMAC_CHCTRLB_TRIGACT_BEAT);
+  dmaSetCallback(_dmaChannel, halfCompleteCallback, 0, DMAC_CHINTENSET_TCMPL);
+  dmaStart(_dmaChannel);
+
+  // the scan starts at the first input with the first conversion
+  expect0(adc_enable(&_adc));
+  adc_start_conversion(&_adc);
+  return 0;
+}
+
+int __MkrAdcScan::stop()
+{
+  if(_dmaChannel < 0) return 0;
+  if(_windowEnabled) return 1;
+
+  adc_disable(&_adc);
+  dmaFree(_dmaChannel);
+  _dmaChannel = -1;
+  return 0;
+}
+
+bool __MkrAdcScan::isRunning()
+{
+  return _dmaChannel >= 0;
+}
+
+static void halfCompleteCallback(void *context, uint8_t flags)
+{
+  uint32_t completed = _halvesCompleted + 1;
+  _halvesCompleted = completed;
+
+  if(_halfCallback) {
+    _halfCallback(_buffer + ((completed - 1) & 1) * _samplesPerHalf, _framesPerHalf);
+  }
+}
+
+const int16_t *__MkrAdcScan::nextHalf()
+{
+  uint32_t completed = _halvesCompleted;
+  if(completed == _halvesConsumed) return NULL;
+
+  // only the latest half is still intact
+  _overruns += completed - _halvesConsumed - 1;
+  _halvesConsumed = completed;
+  return _buffer + ((completed - 1) & 1) * _samplesPerHalf;
+}
+
+int __MkrAdcScan::setAveraging(int accumulateLog2, int shift)
+{
+  if(accumulateLog2 < 0 || accumulateLog2 > 10) return 1;
+  if(shift < 0 || shift > 4 || (accumulateLog2 == 0 && shift != 0)) return 1;
+
+  _accumulateLog2 = accumulateLog2;
+  _averagingShift = shift;
+  return 0;
+}
+
+int __MkrAdcScan::resultBits()
+{
+  if(_accumulateLog2 == 0) return _twelveBits ? 12 : 10;
+  int bits = 12 + _accumulateLog2;
+  return (bits > 16 ? 16 : bits) - _averagingShift;
+}
+
+int __MkrAdcScan::setWindowAbove(int threshold)
+{
+  if(_dmaChannel < 0 || threshold < 0 || threshold >= (1 << resultBits())) return 1;
+
+  adc_set_window_mode(&_adc, ADC_WINDOW_MODE_ABOVE_LOWER, threshold, 0);
+  struct adc_events events = { false, true };
+  adc_enable_events(&_adc, &events);
+  _windowEnabled = true;
+  return 0;
+}
+
+void __MkrAdcScan::clearWindow()
+{
+  if(_dmaChannel < 0) return;
+
+  struct adc_events events = { false, true };
+  adc_disable_events(&_adc, &events);
+  adc_set_window_mode(&_adc, ADC_WINDOW_MODE_DISABLE, 0, 0);
+  _windowEnabled = false;
+}
+
+uint32_t __MkrAdcScan::halvesCompleted()
+{
+  return _halvesCompleted;
+}
+
+uint32_t __MkrAdcScan::overruns()
+{
+  return _overruns;
+}
+
+uint32_t __MkrAdcScan::samplesPerSecond()
+{
+  // half an ADC clock of sampling (SAMPLEN 0) plus 1 + bits/2 clocks of conversion,
+  // averaging converts at 12 bits
+  int bits = (_twelveBits || _accumulateLog2 > 0) ? 12 : 10;
+  uint32_t adcHalfClocksPerSample = (1 + 2 * (1 + bits / 2)) << _accumulateLog2;
+  return 2 * (8000000 / 4) / adcHalfClocksPerSample;
+}
+
+uint32_t __MkrAdcScan::framesPerSecond()
+{
+  return _samplesPerHalf > 0 ? samplesPerSecond() / (_samplesPerHalf / _framesPerHalf) : 0;
+}
+
+int AdcDecimator::begin(int input, int order, int ratio, int inputBits, int outputBits)
+{
+  if(input < 0 || input >= ADC_SCAN_MAX_INPUTS) return 1;
+  if(order < 1 || order > ADC_DECIMATOR_MAX_ORDER) return 1;
+  if(ratio < 1 || ratio > 0x8000 || (ratio & (ratio - 1)) != 0) return 1;
+
+  // CIC gain is ratio^order, all bits of growth are kept until the output
+  int growth = order * (31 - __builtin_clz(ratio));
+  if(inputBits + growth > 31) return 1;
+  if(outputBits < 1 || outputBits > inputBits + growth) return 1;
+
+  _input = input;
+  _order = order;
+  _ratio = ratio;
+  _shift = inputBits + growth - outputBits;
+  _phase = 0;
+  memset(_integrators, 0, sizeof(_integrators));
+  memset(_combs, 0, sizeof(_combs));
+  return 0;
+}
+
+int AdcDecimator::process(const int16_t *frames, int numFrames, int numInputs, int32_t *outputs, int maxOutputs)
+{
+  int numOutputs = 0;
+  const int16_t *sample = frames + _input;
+
+  // integrators and combs wrap modulo 2^32, the differences still come out right
+  for(int i = 0; i < numFrames; i++, sample += numInputs) {
+    uint32_t value = (uint16_t)*sample;
+    for(int s = 0; s < _order; s++) {
+      _integrators[s] += value;
+      value = _integrators[s];
+    }
+
+    if(++_phase < _ratio) continue;
+    _phase = 0;
+
+    for(int s = 0; s < _order; s++) {
+      uint32_t previous = _combs[s];
+      _combs[s] = value;
+      value -= previous;
+    }
+    if(numOutputs < maxOutputs) outputs[numOutputs++] = (int32_t)(value >> _shift);
+  }
+  return numOutputs;
+}
+
+uint32_t AdcDecimator::outputsPerSecond(uint32_t framesPerSecond)
+{
+  return framesPerSecond / _ratio;
+}
@@ -0,0 +1,98 @@
+/*
+ * MkrAdcScan.h
+ *
+ * Created: 19.10.2026 16:41:09
+ * Author: SL
+ */
+
+#ifndef MKRADCSCAN_H_
+#define MKRADCSCAN_H_
+
+#include <Arduino.h>
+
+/*
+ * Continuous ADC acquisition without CPU involvement per sample.
+ *
+ * The ADC runs freely and scans consecutive AIN inputs (INPUTSCAN), the DMAC
+ * moves every result into a buffer of two halves. Each half holds a whole number
+ * of frames, one sample per scanned input in input order. The consumer is
+ * signalled per completed half, either by a callback from the DMAC interrupt
+ * or by polling nextHalf(), and must be done with a half before the other one
+ * is full again.
+ *
+ * With the 8 MHz GCLK3 divided by 4 the ADC converts about 267 ksps at 12 bits
+ * and 308 ksps at 10 bits, shared by all scanned inputs.
+ * Hardware averaging (setAveraging()) trades rate for resolution on the whole
+ * scan, as AVGCTRL is shared by all inputs. AdcDecimator then lowers the rate of
+ * single inputs further in software, so each input runs at its own rate and
+ * resolution from the same scan.
+ * NOTE: the scan owns the ADC, analogRead() must not be used while it runs,
+ * and it cannot start while MkrSineChopperTcc.setBusCompensation() converts.
+ */
+#define ADC_SCAN_MAX_INPUTS 16
+#define ADC_DECIMATOR_MAX_ORDER 3
+
+class __MkrAdcScan {
+  public:
+    // Scans AIN firstInput..firstInput+numInputs-1 into buffer, which holds
+    // 2 * framesPerHalf * numInputs samples. halfCallback runs in the DMAC
+    // interrupt with the completed half. Returns 0 on success.
+    int start(int firstInput, int numInputs, int16_t *buffer, int framesPerHalf,
+      void (*halfCallback)(const int16_t *samples, int frames) = 0,
+      bool twelveBits = true);
+    // Fails while the window is set, an over-current trip would silently go
+    // blind: clearWindow() first. Returns 0 on success.
+    int stop();
+    bool isRunning();
+
+    // Returns the half completed since the last call or NULL, halves which
+    // were completed and replaced in between count as overruns.
+    const int16_t *nextHalf();
+
+    // Each result accumulates 2^accumulateLog2 (0..10) 12-bit conversions and
+    // is shifted right by shift (0..4), results above 16 bits are shifted down
+    // by the ADC. Takes effect with the next start(). Returns 0 on success.
+    int setAveraging(int accumulateLog2, int shift);
+    int resultBits();
+
+    // Raises the window monitor event EVSYS_ID_GEN_ADC_WINMON for every result
+    // above threshold (result units, see resultBits()), e.g. as over-current
+    // trip of MkrSineChopperTcc. The ADC has one window for all scanned inputs.
+    // Only while running, returns 0 on success.
+    int setWindowAbove(int threshold);
+    void clearWindow();
+
+    uint32_t halvesCompleted();
+    uint32_t overruns();
+    uint32_t samplesPerSecond(); // results of all inputs together
+    uint32_t framesPerSecond(); // results per input
+};
+
+extern __MkrAdcScan MkrAdcScan;
+
+// Streaming CIC decimator for one input of the scan: order integrator and comb
+// stages (order 1 is the plain average of ratio results) in wrapping 32-bit
+// fixed point, one output per ratio frames scaled to outputBits.
+class AdcDecimator {
+  public:
+    // ratio must be a power of two and inputBits + order * log2(ratio) at most 31.
+    // Returns 0 on success.
+    int begin(int input, int order, int ratio, int inputBits, int outputBits);
+
+    // Feeds numFrames frames of numInputs results (e.g. a half from nextHalf()),
+    // writes at most maxOutputs outputs and returns their number.
+    int process(const int16_t *frames, int numFrames, int numInputs, int32_t *outputs, int maxOutputs);
+
+    uint32_t outputsPerSecond(uint32_t framesPerSecond);
+
+  private:
+    uint8_t _input;
+    uint8_t _order;
+    uint8_t _shift;
+    uint16_t _ratio;
+    uint16_t _phase;
+    uint32_t _integrators[ADC_DECIMATOR_MAX_ORDER];
+    uint32_t _combs[ADC_DECIMATOR_MAX_ORDER];
+};
+
+#endif /* MKRADCSCAN_H_ */
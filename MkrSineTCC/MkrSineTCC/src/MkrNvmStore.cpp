@@ -0,0 +1,119 @@
+/*
+ * MkrNvmStore.cpp
+ *
+ * Created: 19.10.2026 10:14:41
+ * Author: SL
+ */ 
+
+#include <Arduino.h>
+#include "MkrNvmStore.h"
+#include "MkrUtil.h"
+
+#define NVM_STORE_MAGIC 0x4d6b5231 // "MkR1"
+
+// header of each slot, followed by payload and padded up to a whole number of pages
+struct NvmStoreHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  uint32_t sequence;
+  uint32_t crc; // over header (with crc=0) and payload
+};
+
+static const struct NvmStoreHeader *getSlot(int slot)
+{
+  return (const struct NvmStoreHeader *)(NVM_STORE_ADDRESS + slot * NVMCTRL_ROW_SIZE);
+}
+
+static uint32_t computeBlockCrc(const struct NvmStoreHeader *header, const void *payload)
+{
+  struct NvmStoreHeader h = *header;
+  h.crc = 0;
+  uint32_t crc = computeCrc32(0, &h, sizeof(h));
+  return computeCrc32(crc, payload, h.size);
+}
+
+static bool isSlotValid(int slot, int version)
+{
+  const struct NvmStoreHeader *header = getSlot(slot);
+  if(header->magic != NVM_STORE_MAGIC) return false;
+  if(header->version != version) return false;
+  if(header->size > NVM_STORE_MAX_PAYLOAD) return false;
+  return (computeBlockCrc(header, header + 1) == header->crc);
+}
+
+// Returns index of the slot with the newest valid block or -1.
+static int findNewestSlot(int version)
+{
+  int newest = -1;
+  for(int i = 0; i < NVM_STORE_NUM_SLOTS; i++) {
+    if(!isSlotValid(i, version)) continue;
+    if(newest < 0 || (int32_t)(getSlot(i)->sequence - getSlot(newest)->sequence) > 0)
+      newest = i;
+  }
+  return newest;
+}
+
+int nvmStoreRead(void *payload, int size, int version)
+{
+  int slot = findNewestSlot(version);
+  if(slot < 0) return 1;
+  
+  const struct NvmStoreHeader *header = getSlot(slot);
+  if(header->size != size) return 1;
+  
+  memcpy(payload, header + 1, size);
+  return 0;
+}
+
+static inline void waitNvmReady()
+{
+  while(!(NVMCTRL->INTFLAG.reg & NVMCTRL_INTFLAG_READY));
+}
+
+static void executeNvmCommand(uintptr_t address, uint16_t command)
+{
+  waitNvmReady();
+  NVMCTRL->STATUS.reg |= NVMCTRL_STATUS_MASK;
+  NVMCTRL->ADDR.reg = address / 2; // ADDR is a 16-bit word address
+  NVMCTRL->CTRLA.reg = command | NVMCTRL_CTRLA_CMDEX_KEY;
+  waitNvmReady();
+}
+
+int nvmStoreWrite(const void *payload, int size, int version)
+{
+  if(size < 0 || size > NVM_STORE_MAX_PAYLOAD) return 1;
+  
+  // build the whole row image in RAM so the page buffer is written by words only
+  static uint32_t rowImage[NVMCTRL_ROW_SIZE / 4];
+  memset(rowImage, 0xff, sizeof(rowImage));
+  
+  int newest = findNewestSlot(version);
+  int slot = (newest < 0) ? 0 : (newest + 1) % NVM_STORE_NUM_SLOTS;
+  
+  struct NvmStoreHeader *header = (struct NvmStoreHeader *)rowImage;
+  header->magic = NVM_STORE_MAGIC;
+  header->version = version;
+  header->size = size;
+  header->sequence = (newest < 0) ? 1 : getSlot(newest)->sequence + 1;
+  memcpy(header + 1, payload, size);
+  header->crc = computeBlockCrc(header, header + 1);
+  
+  uintptr_t rowAddress = (uintptr_t)getSlot(slot);
+  executeNvmCommand(rowAddress, NVMCTRL_CTRLA_CMD_ER);
+  
+  // write only pages actually occupied by header and payload
+  int numBytes = sizeof(struct NvmStoreHeader) + size;
+  for(int offset = 0; offset < numBytes; offset += NVMCTRL_PAGE_SIZE) {
+    executeNvmCommand(rowAddress, NVMCTRL_CTRLA_CMD_PBC);
+    volatile uint32_t *dst = (volatile uint32_t *)(rowAddress + offset);
+    for(int i = 0; i < NVMCTRL_PAGE_SIZE / 4; i++)
+      dst[i] = rowImage[offset / 4 + i];
+    executeNvmCommand(rowAddress + offset, NVMCTRL_CTRLA_CMD_WP);
+  }
+  
+  // make sure the following reads do not hit stale cache lines
+  executeNvmCommand(rowAddress, NVMCTRL_CTRLA_CMD_INVALL);
+  
+  return isSlotValid(slot, version) ? 0 : 1;
+}
@@ -0,0 +1,35 @@
+/*
+ * MkrNvmStore.h
+ *
+ * Created: 19.10.2026 10:12:05
+ * Author: SL
+ */ 
+
+#ifndef MKRNVMSTORE_H_
+#define MKRNVMSTORE_H_
+
+#include <Arduino.h>
+
+/*
+ * Persistent parameter block kept in the last two rows of the SAMD21 flash.
+ * The rows are used as A/B slots: a new block is always written into the slot
+ * not holding the newest valid block, so a reset in the middle of erase/write
+ * leaves the previous block intact. Each block is versioned and CRC-checked.
+ * NOTE: the linker scripts reserve NVM_STORE_SIZE bytes at the end of flash.
+ */
+#define NVM_STORE_NUM_SLOTS 2
+#define NVM_STORE_SIZE (NVM_STORE_NUM_SLOTS * NVMCTRL_ROW_SIZE)
+#define NVM_STORE_ADDRESS (FLASH_ADDR + FLASH_SIZE - NVM_STORE_SIZE)
+
+// the largest payload which fits into one slot together with its header
+#define NVM_STORE_MAX_PAYLOAD (NVMCTRL_ROW_SIZE - 16)
+
+// Reads the newest valid payload of given version, returns 0 on success.
+int nvmStoreRead(void *payload, int size, int version);
+
+// Writes the payload into the older slot, returns 0 on success.
+// NOTE: the CPU stalls on flash access during erase, so interrupt handlers
+// running from flash are delayed by a few milliseconds.
+int nvmStoreWrite(const void *payload, int size, int version);
+
+#endif /* MKRNVMSTORE_H_ */
@@ -0,0 +1,119 @@
+/*
+ * MkrSafety.cpp
+ *
+ * Created: 19.10.2026 20:21:55
+ * Author: SL
+ */
+
+#include <Arduino.h>
+
+#include "MkrSafety.h"
+#include "MkrSineChopperTcc.h"
+
+// global single instance
+__MkrSafety MkrSafety;
+
+#define WATCHDOG_CLOCK_HZ 1024
+#define WATCHDOG_MAX_PERIOD_CODE 11 // 16K clocks
+
+// a faulted TCC reports it within a few of its clocks, this bounds the wait
+#define SHUTDOWN_CONFIRM_POLLS 64
+
+static METRIC_MAX_GAUGE(_metricShutdownCycles, "outputShutdownCycles");
+static volatile bool _watchdogExpiring = false;
+
+static void waitWatchdogSync()
+{
+  while(WDT->STATUS.bit.SYNCBUSY);
+}
+
+int __MkrSafety::begin(int watchdogMillis)
+{
+  metricRegister(&_metricShutdownCycles);
+  if(watchdogMillis <= 0) return 0;
+
+  // period of 8 << code clocks, the smallest one covering watchdogMillis
+  uint32_t clocks = (uint32_t)watchdogMillis * WATCHDOG_CLOCK_HZ / 1000;
+  int code = 0;
+  while(code <= WATCHDOG_MAX_PERIOD_CODE && (8ul << code) < clocks) code++;
+  if(code > WATCHDOG_MAX_PERIOD_CODE || code == 0) return 1;
+
+  // GCLK2 runs OSCULP32K undivided from reset and feeds only the watchdog
+  GCLK->GENDIV.reg = GCLK_GENDIV_ID(2) | GCLK_GENDIV_DIV(4); // 2^(4+1)
+  GCLK->GENCTRL.reg = GCLK_GENCTRL_ID(2) | GCLK_GENCTRL_SRC_OSCULP32K |
+    GCLK_GENCTRL_DIVSEL | GCLK_GENCTRL_GENEN;
+  while(GCLK->STATUS.bit.SYNCBUSY);
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_ID_WDT | GCLK_CLKCTRL_GEN_GCLK2 | GCLK_CLKCTRL_CLKEN;
+
+  WDT->CTRL.reg = 0;
+  waitWatchdogSync();
+  WDT->CONFIG.reg = WDT_CONFIG_PER(code);
+  WDT->EWCTRL.reg = WDT_EWCTRL_EWOFFSET(code - 1); // half the period
+  WDT->INTFLAG.reg = WDT_INTFLAG_EW;
+  WDT->INTENSET.reg = WDT_INTENSET_EW;
+  waitWatchdogSync();
+
+  NVIC_SetPriority(WDT_IRQn, 0);
+  NVIC_EnableIRQ(WDT_IRQn);
+
+  WDT->CTRL.reg = WDT_CTRL_ENABLE;
+  waitWatchdogSync();
+  return 0;
+}
+
+void __MkrSafety::feedWatchdog()
+{
+  // writing while the last clear still synchronizes stalls the bus for
+  // milliseconds, and after the early warning the reset must come
+  if(_watchdogExpiring || !(WDT->CTRL.reg & WDT_CTRL_ENABLE)) return;
+  if(WDT->STATUS.bit.SYNCBUSY) return;
+  WDT->CLEAR.reg = WDT_CLEAR_CLEAR_KEY;
+}
+
+void __MkrSafety::shutdown(int reason)
+{
+  uint32_t stamp = metricCycleStamp();
+
+  // all but the drill keep the outputs off until reset
+  if(MkrSineChopperTcc.shutdown(reason != SHUTDOWN_DRILL)) {
+    for(int i = 0; i < SHUTDOWN_CONFIRM_POLLS && !MkrSineChopperTcc.isShutdownConfirmed(); i++);
+  }
+
+  metricUpdateMax(&_metricShutdownCycles, metricCyclesSince(stamp));
+  traceEvent(TRACE_EVENT_OUTPUT_SHUTDOWN, reason);
+}
+
+uint32_t __MkrSafety::worstShutdownCycles()
+{
+  return _metricShutdownCycles.value;
+}
+
+// a corrupted stack or state may have led here, nothing but the shutdown
+// and the trace before waiting for the watchdog
+static void haltAfterFault(int reason)
+{
+  MkrSafety.shutdown(reason);
+  traceFreeze();
+#if defined DEBUG
+  __BKPT(3);
+#endif
+  for(;;);
+}
+
+extern "C" void HardFault_Handler(void)
+{
+  haltAfterFault(SHUTDOWN_HARD_FAULT);
+}
+
+extern "C" void NMI_Handler(void)
+{
+  haltAfterFault(SHUTDOWN_NMI);
+}
+
+extern "C" void WDT_Handler(void)
+{
+  WDT->INTFLAG.reg = WDT_INTFLAG_EW;
+  _watchdogExpiring = true;
+  MkrSafety.shutdown(SHUTDOWN_WATCHDOG);
+  traceFreeze();
+}
@@ -0,0 +1,52 @@
+/*
+ * MkrSafety.h
+ *
+ * Created: 19.10.2026 20:21:55
+ * Author: SL
+ */
+
+#ifndef MKRSAFETY_H_
+#define MKRSAFETY_H_
+
+#include <Arduino.h>
+
+/*
+ * Output shutdown for every way the firmware can fail. panic(), HardFault,
+ * NMI and the watchdog early warning first force all bridge outputs low with
+ * MkrSineChopperTcc.shutdown(), and only then record or print anything.
+ *
+ * The watchdog runs from GCLK2 (OSCULP32K / 32 = 1024 Hz) once begin() enables
+ * it, and the main loop must feed it. Its early warning interrupt comes at half
+ * the period and shuts down, the reset follows at the full period. After a
+ * HardFault, NMI or watchdog shutdown the MCU waits for that reset (forever
+ * without watchdog), a panic keeps feeding it to stay in panic. Until then the
+ * shutdown is latched: the chopper refuses to start, even if the main loop
+ * still runs after the early warning. Only a reset clears the latch.
+ *
+ * The cycles from entering shutdown() until both TCCs report the fault, or
+ * until the pins are released when they were not running, are kept as the
+ * outputShutdownCycles max gauge, see metrics.h.
+ */
+enum SafetyShutdownReason {
+  SHUTDOWN_PANIC = 1,
+  SHUTDOWN_HARD_FAULT,
+  SHUTDOWN_NMI,
+  SHUTDOWN_WATCHDOG,
+  SHUTDOWN_DRILL, // on request, not latched: outputs come back with the next chopper start
+};
+
+class __MkrSafety {
+  public:
+    // Registers the metric and enables the watchdog unless watchdogMillis is 0,
+    // at most 16 seconds. Returns 0 on success.
+    int begin(int watchdogMillis);
+    void feedWatchdog();
+
+    // Shuts the outputs down and records the latency and reason, from any context.
+    void shutdown(int reason);
+    uint32_t worstShutdownCycles();
+};
+
+extern __MkrSafety MkrSafety;
+
+#endif /* MKRSAFETY_H_ */
@@ -0,0 +1,269 @@
+/*
+ * MkrScheduler.cpp
+ *
+ * Created: 19.10.2026 18:12:40
+ * Author: SL
+ */
+
+#include <Arduino.h>
+
+#include "MkrScheduler.h"
+
+// global single instance
+__MkrScheduler MkrScheduler;
+
+// longest sleep without any task scheduled, interrupts wake up earlier anyway
+#define MAX_SLEEP_CYCLES VARIANT_MCK
+
+struct Task {
+  void (*function)(void *context);
+  void *context;
+  const char *name;
+  uint64_t deadline;
+  uint64_t periodCycles; // 0 for tasks due once
+  int8_t heapIndex; // -1 while not scheduled
+  TaskStatistics statistics;
+};
+
+static Task _tasks[SCHEDULER_MAX_TASKS];
+static int _numTasks;
+
+// binary min-heap of task ids ordered by deadline
+static int8_t _heap[SCHEDULER_MAX_TASKS];
+static int _heapSize;
+
+// events posted by interrupt handlers, one bit per task
+static volatile uint32_t _posted;
+static volatile uint32_t _postedAt[SCHEDULER_MAX_TASKS];
+
+static int _running = -1;
+static bool _runningRescheduled;
+
+static METRIC_HISTOGRAM(_metricTaskRunCycles, "taskRunCycles");
+static METRIC_HISTOGRAM(_metricTaskLateCycles, "taskLateCycles");
+
+static inline bool heapEarlier(int a, int b)
+{
+  return _tasks[_heap[a]].deadline < _tasks[_heap[b]].deadline;
+}
+
+static void heapSwap(int a, int b)
+{
+  int8_t task = _heap[a];
+  _heap[a] = _heap[b];
+  _heap[b] = task;
+  _tasks[_heap[a]].heapIndex = a;
+  _tasks[_heap[b]].heapIndex = b;
+}
+
+static void siftUp(int i)
+{
+  while(i > 0) {
+    int parent = (i - 1) >> 1;
+    if(!heapEarlier(i, parent)) break;
+    heapSwap(i, parent);
+    i = parent;
+  }
+}
+
+static void siftDown(int i)
+{
+  for(;;) {
+    int child = 2 * i + 1;
+    int earliest = i;
+    if(child < _heapSize && heapEarlier(child, earliest)) earliest = child;
+    if(child + 1 < _heapSize && heapEarlier(child + 1, earliest)) earliest = child + 1;
+    if(earliest == i) break;
+    heapSwap(i, earliest);
+    i = earliest;
+  }
+}
+
+static void unschedule(int task)
+{
+  int i = _tasks[task].heapIndex;
+  if(i < 0) return;
+
+  // the last entry takes the place and moves whichever way its deadline says
+  _heapSize--;
+  if(i != _heapSize) {
+    _heap[i] = _heap[_heapSize];
+    int moved = _heap[i];
+    _tasks[moved].heapIndex = i;
+    siftDown(i);
+    siftUp(_tasks[moved].heapIndex);
+  }
+  _tasks[task].heapIndex = -1;
+}
+
+static void schedule(int task, uint64_t deadline)
+{
+  unschedule(task);
+  _tasks[task].deadline = deadline;
+  int i = _heapSize++;
+  _heap[i] = task;
+  _tasks[task].heapIndex = i;
+  siftUp(i);
+}
+
+static inline uint64_t microsToCycles(uint32_t micros)
+{
+  return (uint64_t)micros * TIMEBASE_CYCLES_PER_MICROSECOND;
+}
+
+// Moves posted events into the heap, due at the time they were posted.
+static void collectPosted(uint64_t now)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t posted = _posted;
+  _posted = 0;
+  __set_PRIMASK(primask);
+
+  while(posted) {
+    int task = __builtin_ctz(posted);
+    posted &= posted - 1;
+
+    // a task posted again meanwhile has a later stamp, which errs on the late side
+    uint64_t deadline = now - (uint32_t)((uint32_t)now - _postedAt[task]);
+    Task &t = _tasks[task];
+    if(t.heapIndex < 0 || deadline < t.deadline) schedule(task, deadline);
+  }
+}
+
+int __MkrScheduler::addTask(void (*function)(void *context), void *context, const char *name)
+{
+  if(_numTasks >= SCHEDULER_MAX_TASKS || !function) return -1;
+
+  if(_numTasks == 0) {
+    metricRegister(&_metricTaskRunCycles.metric);
+    metricRegister(&_metricTaskLateCycles.metric);
+  }
+
+  Task &t = _tasks[_numTasks];
+  memset(&t, 0, sizeof(t));
+  t.function = function;
+  t.context = context;
+  t.name = name;
+  t.heapIndex = -1;
+  return _numTasks++;
+}
+
+int __MkrScheduler::runIn(int task, uint32_t delayMicros)
+{
+  if(task < 0 || task >= _numTasks) return 1;
+
+  _tasks[task].periodCycles = 0;
+  schedule(task, timebaseCycles() + microsToCycles(delayMicros));
+  if(task == _running) _runningRescheduled = true;
+  return 0;
+}
+
+int __MkrScheduler::runAt(int task, uint64_t cycles)
+{
+  if(task < 0 || task >= _numTasks) return 1;
+
+  _tasks[task].periodCycles = 0;
+  schedule(task, cycles);
+  if(task == _running) _runningRescheduled = true;
+  return 0;
+}
+
+int __MkrScheduler::runEvery(int task, uint32_t periodMicros, uint32_t firstDelayMicros)
+{
+  if(task < 0 || task >= _numTasks || periodMicros == 0) return 1;
+
+  _tasks[task].periodCycles = microsToCycles(periodMicros);
+  schedule(task, timebaseCycles() + microsToCycles(firstDelayMicros));
+  if(task == _running) _runningRescheduled = true;
+  return 0;
+}
+
+int __MkrScheduler::cancel(int task)
+{
+  if(task < 0 || task >= _numTasks) return 1;
+
+  _tasks[task].periodCycles = 0;
+  unschedule(task);
+  if(task == _running) _runningRescheduled = true;
+  return 0;
+}
+
+void __MkrScheduler::post(int task)
+{
+  if(task < 0 || task >= _numTasks) return;
+
+  uint32_t mask = 1ul << task;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if(!(_posted & mask)) {
+    _postedAt[task] = timebaseCycles32();
+    _posted |= mask;
+  }
+  __set_PRIMASK(primask);
+}
+
+void __MkrScheduler::dispatch()
+{
+  uint64_t now = timebaseCycles();
+  if(_posted) collectPosted(now);
+
+  if(_heapSize == 0 || _tasks[_heap[0]].deadline > now) {
+    // checking for posts and sleeping in one masked section, WFI wakes up
+    // for interrupts which became pending since the check
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if(!_posted) timebaseSleepUntil(_heapSize > 0 ? _tasks[_heap[0]].deadline : now + MAX_SLEEP_CYCLES);
+    __set_PRIMASK(primask);
+    return;
+  }
+
+  int task = _heap[0];
+  Task &t = _tasks[task];
+  uint64_t deadline = t.deadline;
+  unschedule(task);
+
+  _running = task;
+  _runningRescheduled = false;
+  uint32_t start = timebaseCycles32();
+  t.function(t.context);
+  uint32_t runCycles = timebaseCycles32() - start;
+  uint32_t lateCycles = start - (uint32_t)deadline;
+  _running = -1;
+
+  TaskStatistics &s = t.statistics;
+  s.runs++;
+  s.runCycles += runCycles;
+  if(runCycles > s.maxRunCycles) s.maxRunCycles = runCycles;
+  if(lateCycles > s.maxLateCycles) s.maxLateCycles = lateCycles;
+  metricRecord(&_metricTaskRunCycles, runCycles);
+  metricRecord(&_metricTaskLateCycles, lateCycles);
+
+  if(!_runningRescheduled && t.periodCycles > 0) {
+    // periods missed by far are dropped rather than run in a burst
+    uint64_t next = deadline + t.periodCycles;
+    now = timebaseCycles();
+    if(next <= now) next = now + t.periodCycles;
+    schedule(task, next);
+  }
+}
+
+int __MkrScheduler::numTasks()
+{
+  return _numTasks;
+}
+
+const char *__MkrScheduler::taskName(int task)
+{
+  if(task < 0 || task >= _numTasks) return "";
+  return _tasks[task].name;
+}
+
+int __MkrScheduler::getStatistics(int task, TaskStatistics *statistics, bool reset)
+{
+  if(task < 0 || task >= _numTasks) return 1;
+
+  *statistics = _tasks[task].statistics;
+  if(reset) memset(&_tasks[task].statistics, 0, sizeof(TaskStatistics));
+  return 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * MkrScheduler.h
+ *
+ * Created: 19.10.2026 18:12:40
+ * Author: SL
+ */
+
+#ifndef MKRSCHEDULER_H_
+#define MKRSCHEDULER_H_
+
+#include <Arduino.h>
+
+/*
+ * Cooperative run-to-completion task scheduler for the main loop.
+ *
+ * Tasks live in a static table and run from dispatch() in deadline order, the
+ * earliest deadline first, kept in a binary heap. A task is due once (runIn()),
+ * periodically (runEvery()) or when an event is posted from an interrupt
+ * handler (post()), which makes it due at the time of the post. Deadlines are
+ * timebase cycles, see timebase.h.
+ * Between tasks dispatch() sleeps until the next deadline or interrupt, so the
+ * loop calling it reacts to interrupts right away and tasks start within the
+ * run time of the longest task after their deadline.
+ * NOTE: tasks must not block (no delay() or waiting for SerialUSB), all
+ * functions except post() are for the main loop only.
+ */
+#define SCHEDULER_MAX_TASKS 16
+
+// run time and lateness (start after the deadline) of a task in CPU cycles
+struct TaskStatistics {
+  uint32_t runs;
+  uint32_t runCycles; // all runs together
+  uint32_t maxRunCycles;
+  uint32_t maxLateCycles;
+};
+
+class __MkrScheduler {
+  public:
+    // Returns the id of the new task or -1 if the table is full.
+    int addTask(void (*function)(void *context), void *context = 0, const char *name = "");
+
+    // Makes the task due once or every periodMicros, starting after firstDelayMicros.
+    // A task may reschedule or cancel itself while it runs. Return 0 on success.
+    int runIn(int task, uint32_t delayMicros);
+    int runAt(int task, uint64_t cycles); // timebaseCycles() deadline
+    int runEvery(int task, uint32_t periodMicros, uint32_t firstDelayMicros = 0);
+    int cancel(int task);
+
+    // Makes the task due now, may be called from interrupt handlers. Posting
+    // a periodic task runs it an extra time and restarts its period.
+    void post(int task);
+
+    // Runs the most urgent due task, or sleeps until the next deadline or
+    // interrupt if none is due. Call it over and over from loop().
+    void dispatch();
+
+    int numTasks();
+    const char *taskName(int task);
+    int getStatistics(int task, TaskStatistics *statistics, bool reset);
+};
+
+extern __MkrScheduler MkrScheduler;
+
+#endif /* MKRSCHEDULER_H_ */
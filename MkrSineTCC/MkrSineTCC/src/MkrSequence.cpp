@@ -0,0 +1,168 @@
+/*
+ * MkrSequence.cpp
+ *
+ * Created: 19.10.2026 19:05:12
+ * Author: SL
+ */
+
+#include <Arduino.h>
+
+#include "MkrSequence.h"
+#include "MkrScheduler.h"
+
+// global single instance
+__MkrSequencer MkrSequencer;
+
+enum SequenceWait {
+  WAIT_NONE = 0,
+  WAIT_DELAY,
+  WAIT_EVENT,
+  WAIT_POLL,
+};
+
+static MkrSequence *_sequences[SEQUENCER_MAX_SEQUENCES];
+static int _numSequences;
+static int _task = -1;
+
+static volatile uint32_t _awaitedEvents;
+static volatile uint32_t _signalled;
+
+int __MkrSequencer::begin()
+{
+  if(_task >= 0) return 0;
+  _task = MkrScheduler.addTask(run, 0, "sequences");
+  return _task < 0 ? 1 : 0;
+}
+
+void __MkrSequencer::signal(int event)
+{
+  uint32_t mask = 1ul << event;
+
+  // cheap enough for every chopper cycle end while nothing awaits it
+  if(!(_awaitedEvents & mask)) return;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  _signalled |= mask;
+  __set_PRIMASK(primask);
+  MkrScheduler.post(_task);
+}
+
+int __MkrSequencer::numRunning()
+{
+  int n = 0;
+  for(int i = 0; i < _numSequences; i++) {
+    if(_sequences[i]) n++;
+  }
+  return n;
+}
+
+// The scheduler task: resumes each sequence whose await is over, then
+// schedules itself for the earliest delay or poll still pending.
+void __MkrSequencer::run(void *context)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t signalled = _signalled;
+  _signalled = 0;
+  __set_PRIMASK(primask);
+
+  // sequences started meanwhile are appended and run in the same pass
+  uint64_t now = timebaseCycles();
+  for(int i = 0; i < _numSequences; i++) {
+    MkrSequence *s = _sequences[i];
+    if(!s) continue;
+
+    bool ready;
+    switch(s->_wait) {
+      case WAIT_DELAY: ready = now >= s->_wakeCycles; break;
+      case WAIT_EVENT: ready = (signalled & s->_eventMask) != 0; break;
+      default: ready = true; break;
+    }
+    if(!ready) continue;
+
+    s->_wait = WAIT_NONE;
+    s->run();
+    if(s->_line == SEQUENCE_LINE_DONE) _sequences[i] = 0;
+  }
+
+  uint64_t next = UINT64_MAX;
+  uint32_t awaited = 0;
+  int n = 0;
+  now = timebaseCycles();
+  for(int i = 0; i < _numSequences; i++) {
+    MkrSequence *s = _sequences[i];
+    if(!s) continue;
+    _sequences[n++] = s;
+
+    if(s->_wait == WAIT_DELAY && s->_wakeCycles < next) next = s->_wakeCycles;
+    else if(s->_wait == WAIT_EVENT) awaited |= s->_eventMask;
+    else if(s->_wait == WAIT_POLL) {
+      uint64_t poll = now + (uint64_t)SEQUENCE_POLL_MICROS * TIMEBASE_CYCLES_PER_MICROSECOND;
+      if(poll < next) next = poll;
+    }
+  }
+  _numSequences = n;
+  _awaitedEvents = awaited;
+
+  if(next != UINT64_MAX) MkrScheduler.runAt(_task, next);
+  else MkrScheduler.cancel(_task);
+}
+
+int MkrSequence::start()
+{
+  if(_task < 0 || isRunning()) return 1;
+
+  int slot = _numSequences;
+  for(int i = 0; i < _numSequences; i++) {
+    if(!_sequences[i]) {
+      slot = i;
+      break;
+    }
+  }
+  if(slot >= SEQUENCER_MAX_SEQUENCES) return 1;
+
+  _line = 0;
+  _wait = WAIT_NONE;
+  _eventMask = 0;
+  _sequences[slot] = this;
+  if(slot == _numSequences) _numSequences++;
+  MkrScheduler.post(_task);
+  return 0;
+}
+
+void MkrSequence::stop()
+{
+  for(int i = 0; i < _numSequences; i++) {
+    if(_sequences[i] == this) _sequences[i] = 0;
+  }
+  _wait = WAIT_NONE;
+}
+
+bool MkrSequence::isRunning()
+{
+  for(int i = 0; i < _numSequences; i++) {
+    if(_sequences[i] == this) return true;
+  }
+  return false;
+}
+
+void MkrSequence::waitMicros(uint32_t micros)
+{
+  _wait = WAIT_DELAY;
+  _wakeCycles = timebaseCycles() + (uint64_t)micros * TIMEBASE_CYCLES_PER_MICROSECOND;
+}
+
+void MkrSequence::waitEvent(int event)
+{
+  _wait = WAIT_EVENT;
+  _eventMask = 1ul << event;
+
+  // signals from now on count, not only after this pass of all sequences
+  _awaitedEvents |= _eventMask;
+}
+
+void MkrSequence::waitPoll()
+{
+  _wait = WAIT_POLL;
+}
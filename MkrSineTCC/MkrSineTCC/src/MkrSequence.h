@@ -0,0 +1,102 @@
+/*
+ * MkrSequence.h
+ *
+ * Created: 19.10.2026 19:05:12
+ * Author: SL
+ */
+
+#ifndef MKRSEQUENCE_H_
+#define MKRSEQUENCE_H_
+
+#include <Arduino.h>
+
+/*
+ * Stackless sequences for steps like "ramp up, wait until stable, switch mode"
+ * without delay() chains or hand-written state machines.
+ *
+ * A sequence is a class derived from MkrSequence whose run() is written as
+ * straight code between SEQUENCE_BEGIN() and SEQUENCE_END() with awaits in
+ * between. Each await returns from run() and the next run() resumes right
+ * after it (protothread style, switch on the line number), so:
+ *   - state which must survive an await lives in members, not local variables
+ *   - awaits must be in run() itself, not in functions it calls
+ *   - no switch statements around awaits
+ * The object is the whole frame, a vtable pointer and ~20 bytes plus the
+ * members. Sequences are allocated statically by the application, there is
+ * no heap and no stack per sequence.
+ *
+ * All sequences run from one MkrScheduler task which MkrSequencer.begin()
+ * adds. It runs when a delay expires or an awaited event is signalled, and
+ * every SEQUENCE_POLL_MICROS while a sequence awaits a condition such as
+ * SerialUSB.available().
+ * Events are numbered 0..31 by the application and signalled with
+ * MkrSequencer.signal(), also from interrupt handlers (chopper cycle end,
+ * ADC half ready). An await sees only signals after it was entered.
+ */
+#define SEQUENCER_MAX_SEQUENCES 8
+#define SEQUENCE_POLL_MICROS 1000
+
+#define SEQUENCE_BEGIN() switch(_line) { case 0:
+#define SEQUENCE_END() } _line = SEQUENCE_LINE_DONE; return
+
+// Ends the sequence right here, as reaching SEQUENCE_END() does.
+#define SEQUENCE_EXIT() do { _line = SEQUENCE_LINE_DONE; return; } while(0)
+
+#define SEQUENCE_AWAIT_(wait) do { _line = __LINE__; wait; return; case __LINE__:; } while(0)
+
+// Resumes after micros.
+#define AWAIT_DELAY(micros) SEQUENCE_AWAIT_(waitMicros(micros))
+
+// Resumes with the next MkrSequencer.signal(event).
+#define AWAIT_EVENT(event) SEQUENCE_AWAIT_(waitEvent(event))
+
+// Resumes once condition is true, checked now and every SEQUENCE_POLL_MICROS.
+#define AWAIT_UNTIL(condition) \
+  do { _line = __LINE__; case __LINE__: if(!(condition)) { waitPoll(); return; } } while(0)
+
+#define SEQUENCE_LINE_DONE 0xFFFF
+
+class MkrSequence {
+  public:
+    MkrSequence() : _line(0), _wait(0), _eventMask(0), _wakeCycles(0) {}
+
+    // Runs from SEQUENCE_BEGIN() on, returns 0 on success and 1 if already
+    // running or all SEQUENCER_MAX_SEQUENCES slots are in use.
+    int start();
+    void stop();
+    bool isRunning();
+
+  protected:
+    virtual void run() = 0;
+
+    // used by the AWAIT macros
+    void waitMicros(uint32_t micros);
+    void waitEvent(int event);
+    void waitPoll();
+
+    uint16_t _line;
+
+  private:
+    friend class __MkrSequencer;
+    uint8_t _wait;
+    uint32_t _eventMask;
+    uint64_t _wakeCycles;
+};
+
+class __MkrSequencer {
+  public:
+    // Adds the scheduler task running all sequences, returns 0 on success.
+    int begin();
+
+    // Resumes sequences awaiting the event, may be called from interrupt handlers.
+    void signal(int event);
+
+    int numRunning();
+
+  private:
+    static void run(void *context);
+};
+
+extern __MkrSequencer MkrSequencer;
+
+#endif /* MKRSEQUENCE_H_ */
@@ -11,9 +11,14 @@
 #include "tcc\tcc.h"
 #include "tcc\tcc_callback.h"
 #include "events\events.h"
+#include "adc\adc.h"
 
 #include "MkrSineChopperTcc.h"
 #include "MkrUtil.h"
+#include "MkrNvmStore.h"
+#include "MkrTelemetry.h"
+#include "MkrScheduler.h"
+#include "MkrAdcScan.h"
 
 // global single instance
 __MkrSineChopperTcc MkrSineChopperTcc;
@@ -33,38 +38,154 @@ static uint32_t _chopMatchValues[MAX_CHOPS_PER_HALF_CYCLE];
 static volatile int _currentChopIndex;
 static int _numChopsPerHalfCycle;
 
+// dead-time correction of each match value, added in the chop interrupt,
+// recomputed with every start from the tables and the current lag
+static int32_t _chopDeadTimeCorrections[MAX_CHOPS_PER_HALF_CYCLE];
+static int _currentLagDegrees = -1; // -1 without dead-time compensation
+
+// shortest on and off time of the low-side output, applied to the table
+static int _minimumPulseClocks = 0;
+static uint32_t _minimumPulseMatch; // in match values, the one the tables were built with
+static int _switchingEventsSaved; // per cycle
+
+// operating point the tables were computed for
+static int _cycleMicroseconds;
+static int _dutyCycle1024;
+
+// block kept in NVM to restart with the same tables right after reset
+#define CHOPPER_STORE_VERSION 3
+struct ChopperStoreBlock {
+  uint32_t clockHz; // tables are only valid for the same F_CPU
+  int32_t cycleMicroseconds;
+  int32_t dutyCycle1024;
+  int32_t chopsPerHalfCycle;
+  uint32_t numClocksPerHalfCycle;
+  uint32_t chopTopValue;
+  uint32_t chopMatchValues[MAX_CHOPS_PER_HALF_CYCLE];
+  int32_t switchingEventsSaved;
+  uint32_t minimumPulseMatch;
+};
+
 // TCCx timer callback functions
 static void endOfHalfCycleCallback(struct tcc_module *const tcc);
 static void endOfChopCallback(struct tcc_module *const tcc);
-static int _callbackCounter = 0;
 static volatile bool _currentlyAtFirstHalfCycle = false;
 
-// user callback function to be fired at the end of each cycle
-static void (*_userSpecifiedCycleEndCallback)();
-#define DEBUG_CALLBACKS 0
+// user callback functions to be fired at the end of each cycle, the deferred one
+// from a scheduler task, the ISR-safe one right in the TCC0 interrupt
+static void (*_userSpecifiedCycleEndCallback)(const ChopperCycleEnd *end);
+static void (*_isrSafeCycleEndCallback)();
+static volatile uint32_t _cycleCount;
+
+// single-producer (TCC0 interrupt) single-consumer (task) queue of cycle ends,
+// free-running indexes masked with the size as in RingBuffer.h
+#define CYCLE_END_QUEUE_SIZE 8
+static ChopperCycleEnd _cycleEndQueue[CYCLE_END_QUEUE_SIZE];
+static volatile uint32_t _cycleEndHead;
+static volatile uint32_t _cycleEndTail;
+static int _cycleEndTask = -1;
+static void runDeferredCycleEnds(void *context);
+
+// callback metrics, see metrics.h
+static METRIC_COUNTER(_metricCallbacks, "chopCallbacks");
+static METRIC_HISTOGRAM(_metricCallbackCycles, "chopCallbackCycles");
+static METRIC_MAX_GAUGE(_metricCallbackMaxCycles, "chopCallbackMaxCycles");
+static METRIC_COUNTER(_metricCycleEndsCoalesced, "chopCycleEndsCoalesced");
+
+// EVSYS channel whose software event is a non-recoverable fault of TCC0 and TCC1,
+// the fault state of each output in use is low
+static struct events_resource _faultEvent;
+static bool _faultEventAttached = false;
+static volatile bool _shutdownLatched = false; // until reset, see shutdown()
+static int attachFaultEvent();
+
+// asynchronous EVSYS channel from the ADC window monitor to fault A of both TCCs
+static struct events_resource _tripEvent;
+static bool _tripEventAttached = false;
+static bool _tripEnabled = false;
+static uint8_t _tripBlankingCycles;
+static METRIC_COUNTER(_metricOverCurrentTrips, "overCurrentTrips");
+static bool _tripCounted; // by isTripped() since the last start
+static int attachTripEvent();
+static void configureTrip(struct tcc_config *config);
+
+// DC-bus feed-forward: the ADC converts the bus input on the TCC0 MC1 event at
+// the top of each chop and the DMAC copies each result into _busSample
+static struct adc_module _busAdc;
+static struct events_resource _busEvent;
+static bool _busEventAttached = false;
+static int _busDmaChannel = -1;
+static volatile uint16_t _busSample;
+static volatile uint16_t _busNominal; // 0 while not compensating
+static int32_t _busMaxDeviation;
+static int32_t _busInverseNominal; // 2^31 / nominal
+static METRIC_COUNTER(_metricBusSamplesRejected, "busSamplesRejected");
+static int startBusSampling(int busInput);
+static void stopBusSampling();
+#define BUS_MIN_NOMINAL 256
+#define Q15_ONE (1L << 15)
+
+// bridge pins of all wave outputs
+#define BRIDGE_PINS (PORT_PA08 | PORT_PA10 | PORT_PA11)
+
+// tracing every chop costs a few percent of CPU and overwrites the trace buffer within milliseconds
+#define TRACE_CHOP_EVENTS 0
 
 // local functions
 static void precomputeChopMatchValues(int cyclesPerSecond, int chopsPerCycle, int percentage);
+static void precomputeDeadTimeCorrections();
+static void enforceMinimumPulse();
+static int countSwitchingEventsPerCycle();
 static void configureTCC1();
 static void configureTCC0forChopping();
 static void configureTCC0forPulsing(int percentage);
 static void startTimersSimultaneously();
+static int startPrecomputed();
+static int setCycleEndCallback(void (*cycleEndCallback)(const ChopperCycleEnd *end));
+
+// The ranges start() accepts, also checked for the operating point from NVM.
+static bool isValidOperatingPoint(int cycleMicroseconds, int dutyCycle1024, int chopsPerHalfCycle)
+{
+  if(cycleMicroseconds < 1 || cycleMicroseconds > 0x00ffffff) return false;
+  if(chopsPerHalfCycle < 0 || chopsPerHalfCycle > MAX_CHOPS_PER_HALF_CYCLE) return false;
+  if(dutyCycle1024 < 0 || dutyCycle1024 > 1023) return false;
+  return true;
+}
 
 int __MkrSineChopperTcc::start(int cycleMicroseconds, 
-  int dutyCycle1024, int chopsPerHalfCycle, void (*cycleEndCallback)())
+  int dutyCycle1024, int chopsPerHalfCycle, void (*cycleEndCallback)(const ChopperCycleEnd *end))
 {
-  if(cycleMicroseconds < 1 || cycleMicroseconds > 0x00ffffff) return 1;
-  if(chopsPerHalfCycle < 0 || chopsPerHalfCycle > MAX_CHOPS_PER_HALF_CYCLE) return 1;
-  if(dutyCycle1024 < 0 || dutyCycle1024 > 1023) return 1;
+  if(!isValidOperatingPoint(cycleMicroseconds, dutyCycle1024, chopsPerHalfCycle)) return 1;
   
   if(_isEnabled) stop();
 
-  _userSpecifiedCycleEndCallback = cycleEndCallback;
+  if(setCycleEndCallback(cycleEndCallback) != 0) return 1;
 
   precomputeChopMatchValues(cycleMicroseconds, chopsPerHalfCycle, dutyCycle1024);
+  _cycleMicroseconds = cycleMicroseconds;
+  _dutyCycle1024 = dutyCycle1024;
+
+  return startPrecomputed();
+}
 
-  if(chopsPerHalfCycle > 0) configureTCC0forChopping();
-  else configureTCC0forPulsing(dutyCycle1024);
+// Configures and starts both timers from the already computed tables,
+// returns nonzero while a latched shutdown holds the outputs low.
+static int startPrecomputed()
+{
+  if(_shutdownLatched) return 1;
+  _tripCounted = false;
+  
+  metricRegister(&_metricCallbacks);
+  metricRegister(&_metricCallbackCycles.metric);
+  metricRegister(&_metricCallbackMaxCycles);
+  metricRegister(&_metricCycleEndsCoalesced);
+  traceEvent(TRACE_EVENT_CHOPPER_START, _cycleMicroseconds);
+  expect0(attachFaultEvent());
+  if(_tripEnabled) expect0(attachTripEvent());
+  precomputeDeadTimeCorrections();
+  
+  if(_numChopsPerHalfCycle > 0) configureTCC0forChopping();
+  else configureTCC0forPulsing(_dutyCycle1024);
 
   configureTCC1();
   
@@ -75,9 +196,344 @@ int __MkrSineChopperTcc::start(int cycleMicroseconds,
   //tcc_enable(&_tcc1);
   
   _isEnabled = true;
+  
+  // a shutdown interrupting the configuration found the pins not yet muxed
+  if(_shutdownLatched) {
+    MkrSineChopperTcc.shutdown();
+    return 1;
+  }
   return 0;
 }
 
+static int attachFaultEvent()
+{
+  if(_faultEventAttached) return 0;
+  
+  // synchronous path as software events need it, see events_trigger()
+  struct events_config config;
+  events_get_config_defaults(&config);
+  if(events_allocate(&_faultEvent, &config) != STATUS_OK) return 1;
+  if(events_attach_user(&_faultEvent, EVSYS_ID_USER_TCC0_EV_1) != STATUS_OK) return 1;
+  if(events_attach_user(&_faultEvent, EVSYS_ID_USER_TCC1_EV_1) != STATUS_OK) return 1;
+  _faultEventAttached = true;
+  return 0;
+}
+
+bool __MkrSineChopperTcc::shutdown(bool latched)
+{
+  if(latched) _shutdownLatched = true;
+  
+  // software event as in events_trigger(), the 16-bit write leaves the
+  // generator and path of the channel as they are
+  if(_faultEventAttached) {
+    EVSYS->CTRL.reg = EVSYS_CTRL_GCLKREQ;
+    ((volatile uint16_t *)&EVSYS->CHANNEL)[0] = EVSYS_CHANNEL_CHANNEL(_faultEvent.channel) | EVSYS_CHANNEL_SWEVT;
+  }
+  
+  // whatever state the TCCs are in, the pins leave them
+  PORT->Group[0].OUTCLR.reg = BRIDGE_PINS;
+  PORT->Group[0].DIRSET.reg = BRIDGE_PINS;
+  PORT->Group[0].PINCFG[8].reg = 0;
+  PORT->Group[0].PINCFG[10].reg = 0;
+  PORT->Group[0].PINCFG[11].reg = 0;
+  
+  return _faultEventAttached && (TCC0->CTRLA.reg & TCC_CTRLA_ENABLE) && (TCC1->CTRLA.reg & TCC_CTRLA_ENABLE);
+}
+
+bool __MkrSineChopperTcc::isShutdownLatched()
+{
+  return _shutdownLatched;
+}
+
+static int attachTripEvent()
+{
+  if(_tripEventAttached) return 0;
+  
+  // recoverable faults need the asynchronous path, see tcc_recoverable_fault_config
+  struct events_config config;
+  events_get_config_defaults(&config);
+  config.generator = EVSYS_ID_GEN_ADC_WINMON;
+  config.path = EVENTS_PATH_ASYNCHRONOUS;
+  config.edge_detect = EVENTS_EDGE_DETECT_NONE;
+  if(events_allocate(&_tripEvent, &config) != STATUS_OK) return 1;
+  if(events_attach_user(&_tripEvent, EVSYS_ID_USER_TCC0_MC_0) != STATUS_OK) return 1;
+  if(events_attach_user(&_tripEvent, EVSYS_ID_USER_TCC1_MC_0) != STATUS_OK) return 1;
+  _tripEventAttached = true;
+  return 0;
+}
+
+// Adds fault A from the MC0 event input to a TCC configuration when the trip is enabled.
+static void configureTrip(struct tcc_config *config)
+{
+  if(!_tripEnabled) return;
+  
+  struct tcc_recoverable_fault_config *fault = &config->wave_ext.recoverable_fault[0];
+  fault->source = TCC_FAULT_SOURCE_ENABLE;
+  fault->halt_action = TCC_FAULT_HALT_ACTION_NON_RECOVERABLE;
+  fault->blanking = _tripBlankingCycles > 0 ? TCC_FAULT_BLANKING_BOTH_EDGE : TCC_FAULT_BLANKING_DISABLE;
+  fault->blanking_cycles = _tripBlankingCycles;
+}
+
+int __MkrSineChopperTcc::setOverCurrentTrip(bool enabled, int blankingCycles)
+{
+  if(blankingCycles < 0 || blankingCycles > 255) return 1;
+  
+  metricRegister(&_metricOverCurrentTrips);
+  _tripEnabled = enabled;
+  _tripBlankingCycles = blankingCycles;
+  
+  // the fault configuration is enable-protected
+  if(_isEnabled) {
+    stop();
+    return startPrecomputed();
+  }
+  return 0;
+}
+
+bool __MkrSineChopperTcc::isTripped()
+{
+  bool tripped = _isEnabled && _tripEnabled && 
+    ((TCC0->INTFLAG.reg | TCC1->INTFLAG.reg) & TCC_INTFLAG_FAULTA);
+  
+  // the fault flag stays set until the restart, count it once
+  if(tripped && !_tripCounted) {
+    _tripCounted = true;
+    metricIncrement(&_metricOverCurrentTrips);
+    traceEvent(TRACE_EVENT_OVER_CURRENT_TRIP, _metricOverCurrentTrips.value);
+  }
+  return tripped;
+}
+
+int __MkrSineChopperTcc::recoverFromTrip()
+{
+  if(!_isEnabled) return 1;
+  
+  stop();
+  return startPrecomputed();
+}
+
+bool __MkrSineChopperTcc::isShutdownConfirmed()
+{
+  return (TCC0->STATUS.reg & TCC_STATUS_FAULT1) && (TCC1->STATUS.reg & TCC_STATUS_FAULT1);
+}
+
+int __MkrSineChopperTcc::setBusCompensation(int busInput, int nominal)
+{
+  if(busInput < 0 || busInput > 19) return 1; // AIN0..19
+  if(nominal != 0 && (nominal < BUS_MIN_NOMINAL || nominal > 4095)) return 1;
+
+  metricRegister(&_metricBusSamplesRejected);
+
+  // the interrupt only compensates with a nonzero nominal, set last
+  _busNominal = 0;
+  if(nominal == 0) {
+    stopBusSampling();
+  } else {
+    if(MkrAdcScan.isRunning()) return 1;
+    stopBusSampling();
+    _busSample = nominal;
+    if(startBusSampling(busInput) != 0) {
+      stopBusSampling();
+      return 1;
+    }
+    _busMaxDeviation = nominal >> 2;
+    _busInverseNominal = (int32_t)((1ul << 31) / nominal);
+    _busNominal = nominal;
+  }
+
+  // the event output of TCC0 is enable-protected
+  if(_isEnabled) {
+    stop();
+    return startPrecomputed();
+  }
+  return 0;
+}
+
+uint32_t __MkrSineChopperTcc::busSamplesRejected()
+{
+  return _metricBusSamplesRejected.value;
+}
+
+static int startBusSampling(int busInput)
+{
+  // single conversions of one input on each start event, clocked as MkrAdcScan
+  struct adc_config config;
+  adc_get_config_defaults(&config);
+  config.clock_source = GCLK_GENERATOR_3; // 8 MHz OSC8M
+  config.clock_prescaler = ADC_CLOCK_PRESCALER_DIV4;
+  config.resolution = ADC_RESOLUTION_12BIT;
+  config.reference = ADC_REFERENCE_INTVCC1;
+  config.gain_factor = ADC_GAIN_FACTOR_DIV2;
+  config.positive_input = (enum adc_positive_input)busInput;
+  config.negative_input = ADC_NEGATIVE_INPUT_GND;
+  config.sample_length = 0;
+  config.event_action = ADC_EVENT_ACTION_START_CONV;
+  if(adc_init(&_busAdc, ADC, &config) != STATUS_OK) return 1;
+
+  _busDmaChannel = dmaAllocate();
+  if(_busDmaChannel < 0) return 1;
+
+  // one beat per result into the same variable, the descriptor links to itself
+  DmacDescriptor *descriptor = dmaDescriptor(_busDmaChannel);
+  dmaSetupBlock(descriptor, &ADC->RESULT.reg, &_busSample, 1, DMAC_BTCTRL_BEATSIZE_HWORD);
+  descriptor->DESCADDR.reg = (uint32_t)descriptor;
+  dmaConfigure(_busDmaChannel, ADC_DMAC_ID_RESRDY, DMAC_CHCTRLB_TRIGACT_BEAT);
+  dmaStart(_busDmaChannel);
+
+  if(!_busEventAttached) {
+    struct events_config eventConfig;
+    events_get_config_defaults(&eventConfig);
+    eventConfig.generator = EVSYS_ID_GEN_TCC0_MCX_1;
+    eventConfig.path = EVENTS_PATH_ASYNCHRONOUS;
+    eventConfig.edge_detect = EVENTS_EDGE_DETECT_NONE;
+    if(events_allocate(&_busEvent, &eventConfig) != STATUS_OK) return 1;
+    if(events_attach_user(&_busEvent, EVSYS_ID_USER_ADC_START) != STATUS_OK) return 1;
+    _busEventAttached = true;
+  }
+
+  return adc_enable(&_busAdc) == STATUS_OK ? 0 : 1;
+}
+
+static void stopBusSampling()
+{
+  if(_busDmaChannel < 0) return;
+
+  adc_disable(&_busAdc);
+  dmaFree(_busDmaChannel);
+  _busDmaChannel = -1;
+}
+
+// The minimum pulse in match values, on-time in match values is half the
+// on-time in clocks for dual-slope counting.
+static uint32_t minimumPulseMatch()
+{
+  uint32_t minimum = (_minimumPulseClocks + 1) / 2;
+  return minimum > _chopTopValue / 2 ? _chopTopValue / 2 : minimum;
+}
+
+// Keeps the on-time and the gap of a partial chop at least the minimum pulse
+// after the corrections, empty and full chops stay as they are.
+static inline uint32_t limitToMinimumPulse(uint32_t onTime)
+{
+  if(onTime == 0 || onTime >= _chopTopValue) return onTime;
+  if(onTime < _minimumPulseMatch) return _minimumPulseMatch;
+  if(onTime > _chopTopValue - _minimumPulseMatch) return _chopTopValue - _minimumPulseMatch;
+  return onTime;
+}
+
+// Scales the on-time of a table match value by nominal / bus in fixed point,
+// as few cycles as possible since it runs for every chop.
+static inline uint32_t compensateForBus(uint32_t matchValue)
+{
+  int32_t deviation = (int32_t)_busSample - _busNominal;
+  if(deviation > _busMaxDeviation || deviation < -_busMaxDeviation) {
+    metricIncrement(&_metricBusSamplesRejected);
+    return matchValue;
+  }
+
+  // e = bus / nominal - 1 in Q15 within +-1/4, then nominal / bus = 1 / (1 + e)
+  // as 1 - e + e^2 - e^3 without a division, at most 0.5% off
+  int32_t e = (deviation * _busInverseNominal) >> 16;
+  int32_t gain = Q15_ONE - ((e * (Q15_ONE - ((e * (Q15_ONE - e)) >> 15))) >> 15);
+
+  // the on-time has up to 24 bits, scaled in two parts to stay within 32 bits
+  uint32_t onTime = _chopTopValue - matchValue;
+  onTime = (onTime >> 15) * gain + (((onTime & 0x7fff) * gain) >> 15);
+  onTime = limitToMinimumPulse(onTime);
+  return onTime < _chopTopValue ? _chopTopValue - onTime : 0;
+}
+
+// Sets the deferred callback, adding the scheduler task which runs it on first use.
+static int setCycleEndCallback(void (*cycleEndCallback)(const ChopperCycleEnd *end))
+{
+  if(cycleEndCallback != NULL && _cycleEndTask < 0) {
+    _cycleEndTask = MkrScheduler.addTask(runDeferredCycleEnds, 0, "cycleEnds");
+    if(_cycleEndTask < 0) return 1;
+  }
+  
+  // stopped, so nothing is produced meanwhile
+  _userSpecifiedCycleEndCallback = cycleEndCallback;
+  _cycleCount = 0;
+  _cycleEndTail = _cycleEndHead;
+  return 0;
+}
+
+void __MkrSineChopperTcc::setIsrSafeCycleEndCallback(void (*callback)())
+{
+  _isrSafeCycleEndCallback = callback;
+}
+
+uint32_t __MkrSineChopperTcc::cycleEndsCoalesced()
+{
+  return _metricCycleEndsCoalesced.value;
+}
+
+// Saves the current operating point and its tables into NVM unless
+// the very same block is already there (saves flash erase cycles).
+// The row erase stalls every interrupt running from flash for milliseconds,
+// the chop interrupt included, so the bridge is stopped during the write.
+int __MkrSineChopperTcc::saveToStore()
+{
+  if(!_isEnabled) return 1;
+  
+  struct ChopperStoreBlock block;
+  memset(&block, 0, sizeof(block));
+  block.clockHz = F_CPU;
+  block.cycleMicroseconds = _cycleMicroseconds;
+  block.dutyCycle1024 = _dutyCycle1024;
+  block.chopsPerHalfCycle = _numChopsPerHalfCycle;
+  block.numClocksPerHalfCycle = _numClocksPerHalfCycle;
+  block.chopTopValue = _chopTopValue;
+  memcpy(block.chopMatchValues, _chopMatchValues, sizeof(block.chopMatchValues));
+  block.switchingEventsSaved = _switchingEventsSaved;
+  block.minimumPulseMatch = _minimumPulseMatch;
+  
+  struct ChopperStoreBlock stored;
+  if(nvmStoreRead(&stored, sizeof(stored), CHOPPER_STORE_VERSION) == 0 &&
+    memcmp(&stored, &block, sizeof(block)) == 0) return 0;
+  
+  stop();
+  int result = nvmStoreWrite(&block, sizeof(block), CHOPPER_STORE_VERSION);
+  if(startPrecomputed() != 0) return 1;
+  return result;
+}
+
+// Restarts the timers with the operating point saved by saveToStore()
+// without recomputing the tables, returns nonzero if there is no valid block.
+int __MkrSineChopperTcc::startFromStore(void (*cycleEndCallback)(const ChopperCycleEnd *end))
+{
+  struct ChopperStoreBlock block;
+  if(nvmStoreRead(&block, sizeof(block), CHOPPER_STORE_VERSION) != 0) return 1;
+  
+  if(block.clockHz != F_CPU) return 1;
+  if(!isValidOperatingPoint(block.cycleMicroseconds, block.dutyCycle1024, block.chopsPerHalfCycle)) return 1;
+  
+  // the timer periods must be the ones precomputeChopMatchValues() derives
+  // from the cycle, TCC0 and TCC1 are configured from them
+  uint32_t halfCycle = convertCycleMicrosecondsToClocksPerCycle(block.cycleMicroseconds) / 2;
+  uint32_t top = block.chopsPerHalfCycle > 0 ? halfCycle / (block.chopsPerHalfCycle * 2) : 0;
+  if(block.chopsPerHalfCycle > 0) halfCycle = top * 2 * block.chopsPerHalfCycle;
+  if(block.numClocksPerHalfCycle == 0 || block.numClocksPerHalfCycle != halfCycle) return 1;
+  if(block.chopTopValue != top || (block.chopsPerHalfCycle > 0 && top == 0)) return 1;
+  for(int i = 0; i < block.chopsPerHalfCycle; i++) 
+    if(block.chopMatchValues[i] > block.chopTopValue) return 1;
+  if(block.minimumPulseMatch > block.chopTopValue / 2) return 1;
+  
+  if(_isEnabled) stop();
+
+  if(setCycleEndCallback(cycleEndCallback) != 0) return 1;
+  _cycleMicroseconds = block.cycleMicroseconds;
+  _dutyCycle1024 = block.dutyCycle1024;
+  _numChopsPerHalfCycle = block.chopsPerHalfCycle;
+  _numClocksPerHalfCycle = block.numClocksPerHalfCycle;
+  _chopTopValue = block.chopTopValue;
+  memcpy(_chopMatchValues, block.chopMatchValues, sizeof(_chopMatchValues));
+  _switchingEventsSaved = block.switchingEventsSaved;
+  _minimumPulseMatch = block.minimumPulseMatch;
+  
+  return startPrecomputed();
+}
+
 static int getDeadTimeCpuCycles()
 {
   // TODO: how to determine the minimal possible value?
@@ -100,11 +556,14 @@ static void configureTCC1()
   config_tcc.pins.enable_wave_out_pin[0] = true;
   config_tcc.pins.wave_out_pin[0]        = PIN_PA10E_TCC1_WO0; // D2 on MKR ZERO
   config_tcc.pins.wave_out_pin_mux[0]    = MUX_PA10E_TCC1_WO0;
+  config_tcc.wave_ext.non_recoverable_fault[0].output = TCC_FAULT_STATE_OUTPUT_0;
 
   config_tcc.compare.match[1] = matchValue;
   config_tcc.pins.enable_wave_out_pin[1] = true;
   config_tcc.pins.wave_out_pin[1]        = PIN_PA11E_TCC1_WO1; // D3 on MKR ZERO
   config_tcc.pins.wave_out_pin_mux[1]    = MUX_PA11E_TCC1_WO1;
+  config_tcc.wave_ext.non_recoverable_fault[1].output = TCC_FAULT_STATE_OUTPUT_0;
+  configureTrip(&config_tcc);
 
   // RAMP2 operation: in cycle A, odd channel output (_WO1) is disabled, and in cycle B, 
   // even channel output (_WO0) is disabled. The ramp cycle changes after each update.
@@ -137,6 +596,8 @@ static void configureTCC0forPulsing(int dutyCycle1024)
   config_tcc.pins.enable_wave_out_pin[0] = true;
   config_tcc.pins.wave_out_pin[0]        = PIN_PA08E_TCC0_WO0; // D11 on MKR-ZERO
   config_tcc.pins.wave_out_pin_mux[0]    = MUX_PA08E_TCC0_WO0;
+  config_tcc.wave_ext.non_recoverable_fault[0].output = TCC_FAULT_STATE_OUTPUT_0;
+  configureTrip(&config_tcc);
   
   // There appears to be a difficulty with TCC0 peripheral: I can't make it output
   // anything into any channel other than _WO0, signal just doesn't go to _WO1-_WO7.
@@ -153,7 +614,7 @@ static void configureTCC0forChopping()
   
   _currentlyAtFirstHalfCycle = true;
   _currentChopIndex = 0;
-  uint32_t firstMatchValue = _chopMatchValues[_currentChopIndex];
+  uint32_t firstMatchValue = _chopMatchValues[_currentChopIndex] + _chopDeadTimeCorrections[_currentChopIndex];
 
   // dual-slope operation to make pulse at the center of the chop:
   // count up from zero to top, then down to bottom zero,
@@ -168,6 +629,11 @@ static void configureTCC0forChopping()
   config_tcc.pins.enable_wave_out_pin[0] = true;
   config_tcc.pins.wave_out_pin[0]        = PIN_PA08E_TCC0_WO0; // D11 on MKR-ZERO
   config_tcc.pins.wave_out_pin_mux[0]    = MUX_PA08E_TCC0_WO0;
+  config_tcc.wave_ext.non_recoverable_fault[0].output = TCC_FAULT_STATE_OUTPUT_0;
+  configureTrip(&config_tcc);
+  
+  // channel 1 has no pin, its match at top starts the bus conversion
+  config_tcc.compare.match[1] = _chopTopValue;
   
   expect0(tcc_init(&_tcc0, TCC0, &config_tcc));
 
@@ -191,8 +657,18 @@ static void startTimersSimultaneously()
   eventActionConfig.input_config[0].modify_action = true;
   eventActionConfig.input_config[0].action = (tcc_event_action)TCC_EVENT0_ACTION_START;
   
-  expect0(tcc_enable_events(&_tcc0, &eventActionConfig));
+  // event 1 stays attached to the fault event of shutdown()
+  eventActionConfig.on_input_event_perform_action[1] = true;
+  eventActionConfig.input_config[1].modify_action = true;
+  eventActionConfig.input_config[1].action = (tcc_event_action)TCC_EVENT1_ACTION_NON_RECOVERABLE_FAULT;
+  
+  // MC0 event input is fault A of the over-current trip
+  eventActionConfig.on_event_perform_channel_action[0] = _tripEnabled;
   expect0(tcc_enable_events(&_tcc1, &eventActionConfig));
+  
+  // MC1 event output of TCC0 starts the bus conversion at the top of each chop
+  eventActionConfig.generate_event_on_channel[1] = _busNominal != 0 && _numChopsPerHalfCycle > 0;
+  expect0(tcc_enable_events(&_tcc0, &eventActionConfig));
 
   tcc_enable(&_tcc0);
   tcc_stop_counter(&_tcc0);
@@ -221,6 +697,7 @@ void __MkrSineChopperTcc::stop()
 {
   if(_isEnabled) {
     _isEnabled = false;
+    traceEvent(TRACE_EVENT_CHOPPER_STOP, 0);
     
     tcc_reset(&_tcc0);
     tcc_reset(&_tcc1);
@@ -230,24 +707,73 @@ void __MkrSineChopperTcc::stop()
   }
 }
 
+// Queues a cycle end for the deferred callback. When the queue is full the
+// newest entry takes the cycle end over instead of blocking or dropping it.
+// As in RingBuffer.h each side publishes its index only after the entry, the
+// barriers keep the compiler from moving the entry accesses across it.
+static void postCycleEnd(uint32_t cycle)
+{
+  uint32_t head = _cycleEndHead;
+  uint32_t time = timebaseCycles32();
+  
+  if(head - _cycleEndTail == CYCLE_END_QUEUE_SIZE) {
+    // the consumer only takes the newest entry while the queue is not full
+    ChopperCycleEnd *newest = &_cycleEndQueue[(head - 1) & (CYCLE_END_QUEUE_SIZE - 1)];
+    newest->cycle = cycle;
+    newest->timeCycles = time;
+    newest->coalesced++;
+    metricIncrement(&_metricCycleEndsCoalesced);
+    return;
+  }
+  
+  ChopperCycleEnd *end = &_cycleEndQueue[head & (CYCLE_END_QUEUE_SIZE - 1)];
+  end->cycle = cycle;
+  end->timeCycles = time;
+  end->coalesced = 0;
+  RING_BUFFER_BARRIER();
+  _cycleEndHead = head + 1;
+  MkrScheduler.post(_cycleEndTask);
+}
+
+static void runDeferredCycleEnds(void *context)
+{
+  while(_cycleEndTail != _cycleEndHead) {
+    RING_BUFFER_BARRIER();
+    uint32_t tail = _cycleEndTail;
+    ChopperCycleEnd end = _cycleEndQueue[tail & (CYCLE_END_QUEUE_SIZE - 1)];
+    RING_BUFFER_BARRIER();
+    _cycleEndTail = tail + 1;
+    
+    void (*callback)(const ChopperCycleEnd *end) = _userSpecifiedCycleEndCallback;
+    if(callback != NULL) callback(&end);
+  }
+}
+
 // at the end of each second half-cycle run a user's cycle callback
 static void handleEndOfHalfCycle()
 {
   bool atFirst = _currentlyAtFirstHalfCycle;
   _currentlyAtFirstHalfCycle = !atFirst;
   if(!atFirst) {
+    uint32_t cycle = _cycleCount + 1;
+    _cycleCount = cycle;
+    if(_isrSafeCycleEndCallback != NULL)
+      _isrSafeCycleEndCallback();
     if(_userSpecifiedCycleEndCallback != NULL)
-      _userSpecifiedCycleEndCallback();
+      postCycleEnd(cycle);
   }
 }
 
 static void endOfHalfCycleCallback(struct tcc_module *const tcc)
 {
-  #if DEBUG_CALLBACKS
-  _callbackCounter += 1;
-  #endif
+  uint32_t stamp = metricCycleStamp();
   
   handleEndOfHalfCycle();
+  
+  uint32_t cycles = metricCyclesSince(stamp);
+  metricIncrement(&_metricCallbacks);
+  metricRecord(&_metricCallbackCycles, cycles);
+  metricUpdateMax(&_metricCallbackMaxCycles, cycles);
 }  
 
 // This callback is called by TCC0 module at the end of each chop period, after
@@ -258,9 +784,7 @@ static void endOfHalfCycleCallback(struct tcc_module *const tcc)
 // let USB stabilize and not compete for cycles with this handler.
 static void endOfChopCallback(struct tcc_module *const tcc)
 {
-  #if DEBUG_CALLBACKS
-  _callbackCounter += 1;
-  #endif
+  uint32_t stamp = metricCycleStamp();
   
   // the current chop index advances
   if(++_currentChopIndex == _numChopsPerHalfCycle) {
@@ -276,10 +800,21 @@ static void endOfChopCallback(struct tcc_module *const tcc)
   // effects when writing occurs in "race condition" with the TCC counter.
   int nextIndex = _currentChopIndex + 1;
   if(nextIndex == _numChopsPerHalfCycle) nextIndex = 0;
-  uint32_t nextMatchValue = _chopMatchValues[nextIndex];  
+  uint32_t nextMatchValue = _chopMatchValues[nextIndex] + _chopDeadTimeCorrections[nextIndex];
+  if(_busNominal) nextMatchValue = compensateForBus(nextMatchValue);
   tcc_set_compare_value(&_tcc0, (tcc_match_capture_channel)0, nextMatchValue);
   
+  #if TRACE_CHOP_EVENTS
+  traceEvent(TRACE_EVENT_CHOP_INDEX, _currentChopIndex);
+  traceEvent(TRACE_EVENT_COMPARE_WRITE, nextMatchValue);
+  #endif
+  
   if(nextIndex == 0) handleEndOfHalfCycle();
+  
+  uint32_t cycles = metricCyclesSince(stamp);
+  metricIncrement(&_metricCallbacks);
+  metricRecord(&_metricCallbackCycles, cycles);
+  metricUpdateMax(&_metricCallbackMaxCycles, cycles);
 }
 
 // Writes an array of the "match" values for individual chops in a sequence of sine wave generation.
@@ -293,8 +828,10 @@ static void precomputeChopMatchValues(int cycleMicroseconds, int chopsPerHalfCyc
   _numChopsPerHalfCycle = chopsPerHalfCycle;
   
   // special case when chopping is disabled
+  _switchingEventsSaved = 0;
   if(chopsPerHalfCycle == 0) {
     _chopTopValue = 0;
+    _minimumPulseMatch = 0;
     return;
   }
   
@@ -322,15 +859,124 @@ static void precomputeChopMatchValues(int cycleMicroseconds, int chopsPerHalfCyc
     int matchValue = (int)(_chopTopValue * (1 - fillFactor));
     _chopMatchValues[i] = matchValue;
   }
+  
+  int switchingEvents = countSwitchingEventsPerCycle();
+  enforceMinimumPulse();
+  _switchingEventsSaved = switchingEvents - countSwitchingEventsPerCycle();
+}
+
+// Limits the on-time of one chop plus the carried area to 0, minimum..top-minimum
+// or top, and returns the area it could not take.
+static int32_t limitPulse(int i, int32_t carry, int32_t minimum)
+{
+  int32_t top = _chopTopValue;
+  int32_t wanted = top - (int32_t)_chopMatchValues[i] + carry;
+  
+  int32_t onTime = wanted;
+  if(onTime < minimum) onTime = onTime * 2 < minimum ? 0 : minimum; // dropped or stretched
+  else if(onTime > top - minimum) onTime = (top - onTime) * 2 < minimum ? top : top - minimum; // merged or shortened
+  
+  _chopMatchValues[i] = top - onTime;
+  return wanted - onTime;
+}
+
+// Removes on and off times shorter than the minimum pulse from the table.
+// The area a chop loses or gains is carried to the next chop towards the
+// middle of the half-cycle, so the volt-second area stays within a minimum
+// pulse and the table stays symmetric. The minimum is kept with the table,
+// the corrections of later restarts keep to it, not to a newer setting.
+static void enforceMinimumPulse()
+{
+  _minimumPulseMatch = minimumPulseMatch();
+  int32_t minimum = _minimumPulseMatch;
+  if(minimum == 0) return;
+  
+  int32_t carryLow = 0;
+  int32_t carryHigh = 0;
+  int low = 0;
+  int high = _numChopsPerHalfCycle - 1;
+  for(; low < high; low++, high--) {
+    carryLow = limitPulse(low, carryLow, minimum);
+    carryHigh = limitPulse(high, carryHigh, minimum);
+  }
+  
+  // an odd middle chop takes the area from both sides
+  if(low == high) limitPulse(low, carryLow + carryHigh, minimum);
+}
+
+// Edges of the low-side output over a cycle, both half-cycles use the same table:
+// two for each partial chop, one where a full chop meets a partial or empty one.
+static int countSwitchingEventsPerCycle()
+{
+  int edges = 0;
+  for(int i = 0; i < _numChopsPerHalfCycle; i++) {
+    uint32_t match = _chopMatchValues[i];
+    uint32_t nextMatch = _chopMatchValues[(i + 1) % _numChopsPerHalfCycle];
+    if(match > 0 && match < _chopTopValue) edges += 2;
+    if((match == 0) != (nextMatch == 0)) edges++;
+  }
+  return 2 * edges;
+}
+
+int __MkrSineChopperTcc::setMinimumPulse(int clocks)
+{
+  if(clocks < 0 || clocks > 0xffff) return 1;
+  
+  _minimumPulseClocks = clocks;
+  return 0;
+}
+
+int __MkrSineChopperTcc::switchingEventsSavedPerCycle()
+{
+  return _switchingEventsSaved;
+}
+
+// Writes the dead-time correction of each chop. During the dead time the load
+// current, not the switches, sets the bridge voltage: a current flowing with
+// the output voltage loses the dead time of on-time, one flowing against it
+// gains it. The sign is estimated per chop from its center angle and the lag
+// of the current, and the corrected match values stay within 0..top.
+static void precomputeDeadTimeCorrections()
+{
+  // on-time in match values is half the on-time in clocks for dual-slope counting
+  int32_t deadTime = (getDeadTimeCpuCycles() + 1) / 2;
+  
+  for(int i = 0; i < _numChopsPerHalfCycle; i++) {
+    // chops without edges, e.g. after enforceMinimumPulse(), have no dead time
+    int32_t correction = 0;
+    bool switching = _chopMatchValues[i] > 0 && _chopMatchValues[i] < _chopTopValue;
+    if(_currentLagDegrees >= 0 && switching) {
+      // chop center at (i + 0.5) * 180 / chops degrees, the current still has
+      // the sign of the previous half-cycle until the lag
+      bool withVoltage = (2 * i + 1) * 180 >= 2 * _numChopsPerHalfCycle * _currentLagDegrees;
+      correction = withVoltage ? -deadTime : deadTime;
+    }
+    
+    int32_t match = (int32_t)_chopMatchValues[i] + correction;
+    if(match < 0) match = 0;
+    if(match > (int32_t)_chopTopValue) match = _chopTopValue;
+    if(switching) match = _chopTopValue - limitToMinimumPulse(_chopTopValue - match);
+    _chopDeadTimeCorrections[i] = match - (int32_t)_chopMatchValues[i];
+  }
+}
+
+int __MkrSineChopperTcc::setDeadTimeCompensation(int currentLagDegrees)
+{
+  if(currentLagDegrees < -1 || currentLagDegrees > 90) return 1;
+  
+  _currentLagDegrees = currentLagDegrees;
+  if(_isEnabled) {
+    stop();
+    return startPrecomputed();
+  }
+  return 0;
 }
 
 // Debug print method.
 void __MkrSineChopperTcc::printValues()
 {
-  #if DEBUG_CALLBACKS
   Serial.print("callbacks=");
-  Serial.print(_callbackCounter);
-  #endif
+  Serial.print(_metricCallbacks.value);
   
   for(int i=0; i<_numChopsPerHalfCycle; i++) {
     Serial.print(" ");
@@ -347,4 +993,25 @@ void __MkrSineChopperTcc::printValues()
   
   Serial.print(" clocksPerHalfCycle=");
   Serial.print(_numClocksPerHalfCycle);
+  
+  Serial.print(" switchingEventsSaved=");
+  Serial.print(_switchingEventsSaved);
+}
+
+void __MkrSineChopperTcc::sendTelemetry()
+{
+  uint8_t buffer[sizeof(struct TelemetryChopperState) + sizeof(_chopMatchValues)];
+  struct TelemetryChopperState *state = (struct TelemetryChopperState *)buffer;
+  
+  state->cycleMicroseconds = _cycleMicroseconds;
+  state->dutyCycle1024 = _dutyCycle1024;
+  state->enabled = _isEnabled;
+  state->chopsPerHalfCycle = _numChopsPerHalfCycle;
+  state->numClocksPerHalfCycle = _numClocksPerHalfCycle;
+  state->chopTopValue = _chopTopValue;
+  state->callbackCounter = _metricCallbacks.value;
+  memcpy(state->chopMatchValues, _chopMatchValues, _numChopsPerHalfCycle * sizeof(uint32_t));
+  
+  expect0(telemetryRecord(TELEMETRY_CHOPPER_STATE, buffer, 
+    sizeof(struct TelemetryChopperState) + _numChopsPerHalfCycle * sizeof(uint32_t)));
 }
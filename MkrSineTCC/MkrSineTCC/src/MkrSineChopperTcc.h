@@ -10,16 +10,101 @@
 
 #include <Arduino.h>
 
+// application events in the trace buffer, see trace.h
+enum ChopperTraceEvent {
+  TRACE_EVENT_CHOPPER_START = TRACE_EVENT_USER, // arg: cycle microseconds
+  TRACE_EVENT_CHOPPER_STOP,
+  TRACE_EVENT_CHOP_INDEX,    // arg: new chop index, only with TRACE_CHOP_EVENTS
+  TRACE_EVENT_COMPARE_WRITE, // arg: match value written, only with TRACE_CHOP_EVENTS
+  TRACE_EVENT_OUTPUT_SHUTDOWN, // arg: SafetyShutdownReason, see MkrSafety.h
+  TRACE_EVENT_OVER_CURRENT_TRIP, // arg: trips since reset
+};
+
+// A cycle end as passed to the deferred callback. When the callback falls
+// behind, cycle ends are merged into the newest queued one: it then stands
+// for cycles cycle - coalesced .. cycle and carries the time of the last.
+struct ChopperCycleEnd {
+  uint32_t cycle; // full cycles since start
+  uint32_t timeCycles; // timebaseCycles32() at the cycle end
+  uint32_t coalesced;
+};
+
 // Sine-wave invertor output pins on ARDUINO MKR ZERO:
 // D2: left high-side signal
 // D3: right high-side signal
 // D11: low-side signal (both left and right)
 class __MkrSineChopperTcc {
   public:
+    // cycleEndCallback runs deferred from a MkrScheduler task, not in the
+    // TCC0 interrupt, so it may take its time. Returns 0 on success.
     int start(int cycleMicroseconds, int dutyCycle1024 = 512, 
-      int chopsPerHalfCycle = 0, void (*cycleEndCallback)() = 0);
+      int chopsPerHalfCycle = 0, void (*cycleEndCallback)(const ChopperCycleEnd *end) = 0);
     void stop();
+    
+    // Runs callback right in the TCC0 interrupt at each cycle end, for ISR-safe
+    // code of a few dozen cycles only (setting flags, MkrSequencer.signal()).
+    // Applies to all following starts.
+    void setIsrSafeCycleEndCallback(void (*callback)());
+    uint32_t cycleEndsCoalesced(); // deferred cycle ends merged since reset
+    
+    // Forces all bridge outputs low from any context, HardFault included:
+    // a non-recoverable fault of both TCCs and the pins as plain low outputs.
+    // Unless latched, stop() and start() again bring the outputs back; latched,
+    // every start fails until reset. Returns true if the TCCs were running,
+    // isShutdownConfirmed() then tells when they are faulted.
+    bool shutdown(bool latched = true);
+    bool isShutdownConfirmed();
+    bool isShutdownLatched();
+    
+    // Over-current trip without CPU: the ADC window event (see
+    // MkrAdcScan::setWindowAbove()) is recoverable fault A of both TCCs with
+    // the non-recoverable halt action, so all outputs go low within a
+    // conversion and a few clocks after the current exceeds the threshold.
+    // The fault input is blanked for blankingCycles (0..255 CPU clocks) after
+    // each output edge to ignore switching spikes. Restarts the timers if
+    // running, returns 0 on success.
+    int setOverCurrentTrip(bool enabled, int blankingCycles = 0);
+    bool isTripped(); // counts the trip as overCurrentTrips when it first tells
+    // Restarts the outputs with the same tables after a trip, returns 0 on success.
+    int recoverFromTrip();
+
+    // DC-bus ripple feed-forward while chopping: the bus voltage on AIN busInput
+    // is converted at the top of every chop (TCC0 MC1 event starts the ADC, the
+    // DMAC copies the result) and each chop end scales the on-time written for
+    // the next chop by nominal / latest bus sample. nominal is the 12-bit result
+    // at the bus voltage the tables are made for, 256..4095, or 0 to disable.
+    // Samples more than 25% off nominal leave the chop as in the table and count
+    // as busSamplesRejected. The conversion needs the ADC, so this fails while
+    // MkrAdcScan runs, and MkrAdcScan.start() fails meanwhile. Restarts the
+    // timers if running, returns 0 on success.
+    int setBusCompensation(int busInput, int nominal);
+    uint32_t busSamplesRejected();
+
+    // Dead-time compensation while chopping: the on-time of each chop grows by
+    // the dead time while the load current flows with the output voltage and
+    // shrinks by it while the current flows against it. The current sign per
+    // chop is estimated from currentLagDegrees (0..90), the phase of the load
+    // current behind the voltage, e.g. from measured zero crossings; -1
+    // disables. The corrections are precomputed per chop with each start, so
+    // the interrupt only adds them. Restarts the timers if running, returns 0
+    // on success.
+    int setDeadTimeCompensation(int currentLagDegrees);
+
+    // Shortest on and off time of the low-side output in CPU clocks, 0 for
+    // none, applied to the tables by the next start(). Shorter pulses near the
+    // zero crossings are dropped and short gaps near the peak are merged into
+    // full chops, their area moves to the neighbouring chops so the area of
+    // each half-cycle stays within one minimum pulse.
+    int setMinimumPulse(int clocks);
+    int switchingEventsSavedPerCycle(); // by the minimum pulse, for the running tables
+
+    // persistent operating point, see MkrNvmStore.h; when the block changed
+    // the outputs are stopped for the flash write (a few milliseconds)
+    int saveToStore();
+    int startFromStore(void (*cycleEndCallback)(const ChopperCycleEnd *end) = 0);
+    
     void printValues();
+    void sendTelemetry(); // see MkrTelemetry.h
 };
 
 extern __MkrSineChopperTcc MkrSineChopperTcc;
@@ -0,0 +1,103 @@
+/*
+ * MkrTelemetry.cpp
+ *
+ * Created: 19.10.2026 14:05:52
+ * Author: SL
+ */
+
+#include <Arduino.h>
+#include "MkrTelemetry.h"
+#include "MkrUtil.h"
+
+// frame being collected: seq, records, room for the crc
+static uint8_t _frame[2 + TELEMETRY_MAX_RECORDS_SIZE + 4];
+static int _frameSize = 2;
+static uint16_t _sequence = 0;
+static uint32_t _droppedFrames = 0;
+
+// COBS adds one byte per 254 and the two delimiters
+static uint8_t _encoded[sizeof(_frame) + sizeof(_frame) / 254 + 1 + 2];
+
+// Consistent Overhead Byte Stuffing, returns the encoded size.
+static int encodeCobs(const uint8_t *src, int size, uint8_t *dst)
+{
+  int codeIndex = 0;
+  int n = 1;
+  uint8_t code = 1;
+  for(int i = 0; i < size; i++) {
+    if(src[i] != 0) {
+      dst[n++] = src[i];
+      code++;
+    }
+    if(src[i] == 0 || code == 0xFF) {
+      dst[codeIndex] = code;
+      codeIndex = n++;
+      code = 1;
+    }
+  }
+  dst[codeIndex] = code;
+  return n;
+}
+
+int telemetryRecord(int type, const void *payload, int size)
+{
+  if(size < 0 || size > TELEMETRY_MAX_RECORD_PAYLOAD) return 1;
+  if(2 + size > TELEMETRY_MAX_RECORDS_SIZE) return 1;
+
+  if(_frameSize + 2 + size > 2 + TELEMETRY_MAX_RECORDS_SIZE) {
+    telemetryFlush();
+  }
+
+  _frame[_frameSize++] = type;
+  _frame[_frameSize++] = size;
+  memcpy(_frame + _frameSize, payload, size);
+  _frameSize += size;
+  return 0;
+}
+
+int telemetrySamples(int channel, const int16_t *samples, int count)
+{
+  uint8_t buffer[sizeof(struct TelemetrySamples) + TELEMETRY_MAX_SAMPLES_PER_RECORD * sizeof(int16_t)];
+  struct TelemetrySamples *record = (struct TelemetrySamples *)buffer;
+
+  for(int first = 0; first < count; first += record->count) {
+    int n = count - first;
+    if(n > (int)TELEMETRY_MAX_SAMPLES_PER_RECORD) n = TELEMETRY_MAX_SAMPLES_PER_RECORD;
+    record->channel = channel;
+    record->count = n;
+    record->firstIndex = first;
+    memcpy(record->samples, samples + first, n * sizeof(int16_t));
+
+    int size = sizeof(struct TelemetrySamples) + n * sizeof(int16_t);
+    if(telemetryRecord(TELEMETRY_SAMPLES, buffer, size) != 0) return 1;
+  }
+  return 0;
+}
+
+void telemetryFlush()
+{
+  if(_frameSize <= 2) return;
+
+  _frame[0] = _sequence & 0xFF;
+  _frame[1] = _sequence >> 8;
+  _sequence++;
+
+  uint32_t crc = computeCrc32(0, _frame, _frameSize);
+  memcpy(_frame + _frameSize, &crc, 4);
+
+  _encoded[0] = 0;
+  int size = 1 + encodeCobs(_frame, _frameSize + 4, _encoded + 1);
+  _encoded[size++] = 0;
+  _frameSize = 2;
+
+  if(!SerialUSB || SerialUSB.availableForWrite() < size) {
+    _droppedFrames++;
+    return;
+  }
+  SerialUSB.write(_encoded, size);
+}
+
+uint32_t telemetryDroppedFrames()
+{
+  return _droppedFrames;
+}
@@ -0,0 +1,80 @@
+/*
+ * MkrTelemetry.h
+ *
+ * Created: 19.10.2026 14:02:17
+ * Author: SL
+ */
+
+#ifndef MKRTELEMETRY_H_
+#define MKRTELEMETRY_H_
+
+#include <stdint.h>
+
+/*
+ * Binary telemetry stream sent over SerialUSB instead of ASCII status lines.
+ *
+ * Records are collected into a frame and sent together by telemetryFlush():
+ *   frame  = seq(u16) record* crc32(u32)   CRC over seq and records
+ *   record = type(u8) length(u8) payload[length]
+ * Each frame is COBS-encoded and enclosed in 0x00 delimiters, so a receiver
+ * can resynchronize after text output or lost bytes. All values are little-endian.
+ * A gap in seq means frames were dropped because the host did not read fast enough.
+ *
+ * This header only depends on stdint.h so that host tools can include it,
+ * see HostTools/TelemetryRecorder.cpp.
+ */
+#define TELEMETRY_MAX_RECORDS_SIZE 240 // encoded frame fits into one CDC IN bank
+#define TELEMETRY_MAX_RECORD_PAYLOAD 255
+
+enum TelemetryRecordType {
+  TELEMETRY_CHOPPER_STATE = 1,
+  TELEMETRY_COUNTERS = 2,
+  TELEMETRY_SAMPLES = 3,
+};
+
+struct __attribute__((packed)) TelemetryChopperState {
+  int32_t cycleMicroseconds;
+  int16_t dutyCycle1024;
+  uint8_t enabled;
+  uint8_t chopsPerHalfCycle; // number of chopMatchValues following
+  uint32_t numClocksPerHalfCycle;
+  uint32_t chopTopValue;
+  uint32_t callbackCounter;
+  uint32_t chopMatchValues[];
+};
+
+struct __attribute__((packed)) TelemetryCounters {
+  uint32_t loopCount; // runs of the telemetry task
+  uint32_t cycleEnds;
+  uint32_t droppedFrames;
+};
+
+struct __attribute__((packed)) TelemetrySamples {
+  uint8_t channel;
+  uint8_t count; // number of samples following
+  uint16_t firstIndex; // index of samples[0] within the block sent
+  int16_t samples[];
+};
+
+#define TELEMETRY_MAX_SAMPLES_PER_RECORD \
+  ((TELEMETRY_MAX_RECORDS_SIZE - 2 - sizeof(struct TelemetrySamples)) / sizeof(int16_t))
+
+#ifndef TELEMETRY_HOST_ONLY
+
+// Appends a record to the current frame, flushing the frame first if the record
+// does not fit anymore. Returns 0 on success, 1 if the record is too large.
+// NOTE: not interrupt-safe, use from the main loop only.
+int telemetryRecord(int type, const void *payload, int size);
+
+// Sends a block of samples, split into as many records as needed.
+int telemetrySamples(int channel, const int16_t *samples, int count);
+
+// Sends the current frame if it holds any records. The frame is dropped
+// without blocking if SerialUSB is not open or its transmit buffer is full.
+void telemetryFlush();
+
+uint32_t telemetryDroppedFrames();
+
+#endif
+
+#endif /* MKRTELEMETRY_H_ */
@@ -7,6 +7,8 @@
 
 #include <Arduino.h>
 #include "MkrUtil.h"
+#include "MkrScheduler.h"
+#include "MkrSafety.h"
 
 // clock speed defined in command line options
 #ifndef F_CPU
@@ -26,6 +28,18 @@ int convertCycleMicrosecondsToClocksPerCycle(int cycleMicroseconds)
   return (F_CPU / MICROS_PER_SECOND) * cycleMicroseconds;
 }
 
+uint32_t computeCrc32(uint32_t crc, const void *data, int size)
+{
+  const uint8_t *p = (const uint8_t *)data;
+  crc = ~crc;
+  while(size-- > 0) {
+    crc ^= *p++;
+    for(int i = 0; i < 8; i++) 
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
 void blink(int numBlinks, int msDelayEach)
 {
   pinMode(LED_BUILTIN, OUTPUT);
@@ -39,18 +53,217 @@ void blink(int numBlinks, int msDelayEach)
   }  
 }
 
+// Prints durations of the boot phases recorded by main(), see boot.h.
+void printBootPhases()
+{
+  Serial.print("Boot:");
+  for(int i = 0; i < BOOT_PHASE_COUNT; i++) {
+    BootPhase phase = (BootPhase)i;
+    if(!bootPhaseIsRecorded(phase)) continue;
+    PRINT_FORMAT(Serial, " {}={}us", bootPhaseName(phase), bootPhaseDurationMicros(phase));
+  }
+  Serial.println("");
+}
+
+// Prints a snapshot of all registered metrics, one per line, see metrics.h.
+// Histograms are printed as "<limit:count" per non-empty bucket.
+void printMetrics(bool reset)
+{
+  for(Metric *metric = metricFirst(); metric != NULL; metric = metric->next) {
+    MetricSnapshot snapshot;
+    metricSnapshot(metric, &snapshot, reset);
+    
+    PRINT_FORMAT(Serial, "{}={}", snapshot.name, snapshot.value);
+    if(snapshot.kind == METRIC_KIND_HISTOGRAM) {
+      for(int i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+        if(snapshot.buckets[i] == 0) continue;
+        uint32_t limit = metricBucketLimit(i);
+        if(limit > 0) PRINT_FORMAT(Serial, " <{}:{}", limit, snapshot.buckets[i]);
+        else PRINT_FORMAT(Serial, " rest:{}", snapshot.buckets[i]);
+      }
+    }
+    Serial.println("");
+  }
+}
+
+// Prints runs, mean and maximum run time and maximum lateness of each task
+// since the last reset, see MkrScheduler.h.
+void printTaskStatistics(bool reset)
+{
+  for(int task = 0; task < MkrScheduler.numTasks(); task++) {
+    TaskStatistics s;
+    MkrScheduler.getStatistics(task, &s, reset);
+    uint32_t meanCycles = s.runs > 0 ? s.runCycles / s.runs : 0;
+    PRINT_FORMAT(Serial, "{} runs={} meanUs={} maxUs={} maxLateUs={}\r\n", MkrScheduler.taskName(task), s.runs,
+      meanCycles / TIMEBASE_CYCLES_PER_MICROSECOND, s.maxRunCycles / TIMEBASE_CYCLES_PER_MICROSECOND,
+      s.maxLateCycles / TIMEBASE_CYCLES_PER_MICROSECOND);
+  }
+}
+
+// Streams a "THRU" header, 32-bit byte count and numBytes of a counting pattern
+// as fast as SerialUSB accepts them, see HostTools/CdcThroughput.cpp.
+void runCdcThroughputTest(uint32_t numBytes)
+{
+  static uint8_t pattern[256];
+  for(int i = 0; i < 256; i++) pattern[i] = i;
+  
+  Serial.write("THRU");
+  Serial.write((const uint8_t *)&numBytes, sizeof(numBytes));
+  
+  uint32_t sent = 0;
+  while(sent < numBytes && SerialUSB.dtr()) {
+    uint32_t offset = sent & 0xff;
+    uint32_t n = min(256 - offset, numBytes - sent);
+    sent += Serial.write(&pattern[offset], n);
+    MkrSafety.feedWatchdog(); // may take longer than the watchdog period
+  }
+  
+  Serial.flush();
+  Serial.clearWriteError(); // a timed out write is reported as write error
+}
+
 void panicAt(int code, const char *file, int line)
 {
+  // outputs first, everything else may take milliseconds
+  MkrSafety.shutdown(SHUTDOWN_PANIC);
+  
+  // keep the events which led here for a post-mortem dump
+  traceEvent(TRACE_EVENT_PANIC, code);
+  traceFreeze();
+  
   for(;;) {
+    MkrSafety.feedWatchdog(); // stay in panic with the outputs off
     blink(10, 80); // 10 blinks 80ms each
         
     delay(200);
-    Serial.print("Panic Code=");
-    Serial.print(code);
-    Serial.print(" Line=");
-    Serial.print(line);
-    Serial.print(" [");
-    Serial.print(file);
-    Serial.println("]");
+    PRINT_FORMAT(Serial, "Panic Code={} Line={} [{}] shutdownCycles={}\r\n", code, line, file,
+      MkrSafety.worstShutdownCycles());
   }  
 }
+
+// Writes all of data unless the host stops taking it, a dump may take longer
+// than the watchdog period.
+static void writeFully(const void *data, size_t size)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
+  while(size > 0 && SerialUSB.dtr()) {
+    size_t n = Serial.write(bytes, size);
+    MkrSafety.feedWatchdog();
+    if(n == 0) break; // timed out
+    bytes += n;
+    size -= n;
+  }
+}
+
+// Writes the trace buffer oldest record first as a binary blob: "TRCE", 
+// 32-bit record count, 32-bit total number of records written, 32-bit frozen 
+// flag and the records, see trace.h and HostTools/TraceDump.cpp.
+// NOTE: recording is frozen while dumping, the caller decides when to resume.
+void dumpTrace()
+{
+  uint32_t frozen = traceIsFrozen();
+  traceFreeze();
+  
+  uint32_t total = traceCount();
+  uint32_t count = total < TRACE_CAPACITY ? total : TRACE_CAPACITY;
+  
+  writeFully("TRCE", 4);
+  writeFully(&count, sizeof(count));
+  writeFully(&total, sizeof(total));
+  writeFully(&frozen, sizeof(frozen));
+  for(uint32_t i = 0; i < count; i++) {
+    writeFully(traceRecord(i), sizeof(TraceRecord));
+  }
+  Serial.flush();
+  Serial.clearWriteError();
+}
+
+// discards everything, so only the formatting is measured
+class NullPrint : public Print {
+  public:
+    virtual size_t write(uint8_t) { return 1; }
+    virtual size_t write(const uint8_t *buffer, size_t size) { return size; }
+};
+
+// Print::printNumber() before format.c as reference
+static size_t printNumberReference(Print &p, unsigned long n, uint8_t base)
+{
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while(n);
+  return p.write(str);
+}
+
+// Print::printFloat() before format.c as reference, non-negative numbers only
+static size_t printFloatReference(Print &p, double number, uint8_t digits)
+{
+  double rounding = 0.5;
+  for (uint8_t i=0; i<digits; ++i)
+    rounding /= 10.0;
+  number += rounding;
+  
+  unsigned long int_part = (unsigned long)number;
+  double remainder = number - (double)int_part;
+  size_t n = printNumberReference(p, int_part, 10);
+  if (digits > 0) n += p.write('.');
+  while (digits-- > 0) {
+    remainder *= 10.0;
+    unsigned int toPrint = (unsigned int)(remainder);
+    n += printNumberReference(p, toPrint, 10);
+    remainder -= toPrint;
+  }
+  return n;
+}
+
+// Smallest number of cycles of any of the runs, interrupts only make runs longer.
+template<typename F> static uint32_t measureCycles(F f)
+{
+  uint32_t best = 0xFFFFFFFF;
+  for(int i = 0; i < 16; i++) {
+    uint32_t stamp = metricCycleStamp();
+    f();
+    uint32_t cycles = metricCyclesSince(stamp);
+    if(cycles < best) best = cycles;
+  }
+  return best;
+}
+
+// Prints CPU cycles per call of the previous and the current Print formatting,
+// host side counterpart: HostTools/FormatBenchmark.cpp.
+void runPrintBenchmark()
+{
+  static const uint32_t values[] = { 7, 1234, 65535, 4294967295UL };
+  static const int numValues = sizeof(values) / sizeof(values[0]);
+  NullPrint sink;
+  volatile uint8_t base = DEC; // runtime base as in Print
+  
+  for(int i = 0; i < numValues; i++) {
+    uint32_t v = values[i];
+    uint32_t before = measureCycles([&]() { printNumberReference(sink, v, base); });
+    uint32_t after = measureCycles([&]() { sink.print(v, base); });
+    Serial.print("print(");
+    Serial.print(v);
+    Serial.print(") cycles: old=");
+    Serial.print(before);
+    Serial.print(" new=");
+    Serial.println(after);
+  }
+  
+  volatile double number = 1234.5678;
+  volatile long fixed = (long)(1234.5678 * 65536);
+  uint32_t before = measureCycles([&]() { printFloatReference(sink, number, 2); });
+  uint32_t after = measureCycles([&]() { sink.print(number, 2); });
+  uint32_t fixedCycles = measureCycles([&]() { sink.printFixed(fixed, 16, 2); });
+  Serial.print("print(1234.5678, 2) cycles: old=");
+  Serial.print(before);
+  Serial.print(" new=");
+  Serial.print(after);
+  Serial.print(" printFixed(Q16)=");
+  Serial.println(fixedCycles);
+}
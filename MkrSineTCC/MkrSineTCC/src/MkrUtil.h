@@ -8,6 +8,8 @@
 #ifndef MKRUTIL_H_
 #define MKRUTIL_H_
 
+#include <stdint.h>
+
 /*
  * Panic management functions.
  */
@@ -24,8 +26,17 @@ void panicAt(int code, const char *file, int line);
 #endif
 
 void blink(int numBlinks, int msDelayEach);
+void printBootPhases();
+void printMetrics(bool reset);
+void printTaskStatistics(bool reset);
+void runCdcThroughputTest(uint32_t numBytes);
+void dumpTrace();
+void runPrintBenchmark();
 
 int convertHertzToCycleMicroseconds(int hertz);
 int convertCycleMicrosecondsToClocksPerCycle(int cycleMicroseconds);
 
+// Standard CRC-32 (IEEE 802.3), may be chained by passing previous result as crc.
+uint32_t computeCrc32(uint32_t crc, const void *data, int size);
+
 #endif /* MKRUTIL_H_ */
\ No newline at end of file
@@ -3,55 +3,284 @@
 #include <system.h> // ASF core
 #include "MkrSineChopperTcc.h"
 #include "MkrUtil.h"
+#include "MkrTelemetry.h"
+#include "MkrAdcScan.h"
+#include "MkrScheduler.h"
+#include "MkrSequence.h"
+#include "MkrSafety.h"
 
+// events of MkrSequencer signalled from interrupt handlers
+enum SketchEvent {
+  EVENT_CYCLE_END,
+  EVENT_SCAN_HALF,
+};
+
+// runs deferred from a task, coalesced cycle ends are counted as well
 static int _numCycleEnds = 0;
-static void atCycleEndCallback()
+static void atCycleEndCallback(const ChopperCycleEnd *end)
+{
+  _numCycleEnds += 1 + end->coalesced;
+}
+
+// runs inline in the TCC0 interrupt, see setIsrSafeCycleEndCallback()
+static void atCycleEndIsrSafe()
 {
-  _numCycleEnds += 1;
+  MkrSequencer.signal(EVENT_CYCLE_END);
 }
 
+#define CHOPPER_HZ 7000
+#define CHOPPER_DUTY_CYCLE_1024 (1023 * 25 / 100)
+#define CHOPPER_MINIMUM_PULSE_CLOCKS 96 // 2us, what the gate drivers resolve
+
 static void restartChopper()
 {
   MkrSineChopperTcc.stop();
-  int hz = 7000;
-  int dutyCycle1024 = 1023 * 25 / 100;
   int chopsPerHalfCycle = 0; // zero chops for pulsing mode
+  expect0(MkrSineChopperTcc.setMinimumPulse(CHOPPER_MINIMUM_PULSE_CLOCKS));
   expect0(
-    MkrSineChopperTcc.start(convertHertzToCycleMicroseconds(hz),
-      dutyCycle1024, chopsPerHalfCycle, atCycleEndCallback));
+    MkrSineChopperTcc.start(convertHertzToCycleMicroseconds(CHOPPER_HZ),
+      CHOPPER_DUTY_CYCLE_1024, chopsPerHalfCycle, atCycleEndCallback));
+      
+  // remember operating point for the next reset (writes only when changed)
+  expect0(MkrSineChopperTcc.saveToStore());
 }
 
-// the setup function runs once when you press reset or power the board
-void setup() 
+// ADC scan of A3..A6 (AIN4..AIN7), see MkrAdcScan.h
+#define SCAN_FIRST_INPUT 4
+#define SCAN_INPUTS 4
+#define SCAN_FRAMES_PER_HALF 64
+static int16_t _scanBuffer[2 * SCAN_FRAMES_PER_HALF * SCAN_INPUTS];
+
+static void scanHalfCallback(const int16_t *samples, int frames)
 {
-  SerialUSB.begin(115200);
-  delay(1000); // let USB setup finish racing interrupts
+  MkrSequencer.signal(EVENT_SCAN_HALF);
+}
+
+// Starts the scan unless it runs, fails while the bus compensation uses the ADC.
+static int startScan()
+{
+  if(MkrAdcScan.isRunning()) return 0;
+  return MkrAdcScan.start(SCAN_FIRST_INPUT, SCAN_INPUTS, _scanBuffer, SCAN_FRAMES_PER_HALF, scanHalfCallback);
+}
+
+// Soft restart of the chopper: raises the duty cycle in steps, lets the output
+// settle for some cycles and waits for a fresh ADC half when scanning, before
+// the operating point is saved.
+#define RAMP_STEPS 4
+#define RAMP_STEP_MICROS 50000L
+#define RAMP_SETTLE_CYCLES 100
+class RampSequence : public MkrSequence {
+  protected:
+    void run();
+    
+  private:
+    int _step;
+    int _settledCycles;
+};
+
+void RampSequence::run()
+{
+  SEQUENCE_BEGIN();
+  for(_step = 1; _step <= RAMP_STEPS; _step++) {
+    if(MkrSineChopperTcc.isShutdownLatched()) SEQUENCE_EXIT();
+    expect0(MkrSineChopperTcc.start(convertHertzToCycleMicroseconds(CHOPPER_HZ),
+      CHOPPER_DUTY_CYCLE_1024 * _step / RAMP_STEPS, 0, atCycleEndCallback));
+    AWAIT_DELAY(RAMP_STEP_MICROS);
+  }
+  
+  for(_settledCycles = 0; _settledCycles < RAMP_SETTLE_CYCLES; _settledCycles++) {
+    AWAIT_EVENT(EVENT_CYCLE_END);
+  }
+  if(MkrAdcScan.isRunning()) {
+    AWAIT_EVENT(EVENT_SCAN_HALF);
+  }
+  
+  if(MkrSineChopperTcc.isShutdownLatched()) SEQUENCE_EXIT();
+  expect0(MkrSineChopperTcc.saveToStore());
+  SEQUENCE_END();
+}
+
+static RampSequence _ramp;
+
+// sends the latest half buffer as one sample block per input
+static void sendScanSamples()
+{
+  const int16_t *half = MkrAdcScan.nextHalf();
+  if(!half) return;
+  
+  int16_t samples[SCAN_FRAMES_PER_HALF];
+  for(int input = 0; input < SCAN_INPUTS; input++) {
+    for(int i = 0; i < SCAN_FRAMES_PER_HALF; i++) samples[i] = half[i * SCAN_INPUTS + input];
+    expect0(telemetrySamples(SCAN_FIRST_INPUT + input, samples, SCAN_FRAMES_PER_HALF));
+  }
+}
 
+static int _blinkTask = -1;
+static int _telemetryTask = -1;
+static int _supervisionTask = -1;
+
+// LED pattern of 1, 2 and 3 blinks, the chopper is ramped up again after each third
+#define BLINK_MICROS 200000L
+#define BLINK_PAUSE_MICROS 1000000L
+#define BLINK_MAX_COUNT 3
+static void blinkTask(void *context)
+{
+  static int count = 1;
+  static int toggles = 0;
+  
+  if(toggles < 2 * count) {
+    toggles++;
+    digitalWrite(LED_BUILTIN, (toggles & 1) ? HIGH : LOW);
+    MkrScheduler.runIn(_blinkTask, BLINK_MICROS / 2);
+    return;
+  }
+  
+  toggles = 0;
+  if(++count > BLINK_MAX_COUNT) {
+    count = 1;
+    MkrScheduler.post(_supervisionTask);
+  }
+  MkrScheduler.runIn(_blinkTask, BLINK_PAUSE_MICROS);
+}
+
+// over-current trip on the scanned inputs, see setOverCurrentTrip()
+#define OVER_CURRENT_THRESHOLD 3500 // 12-bit result
+#define OVER_CURRENT_BLANKING_CYCLES 48 // 1us after each edge
+static bool _overCurrentTripEnabled = false;
+
+// DC-bus ripple feed-forward from A0 (AIN0), see setBusCompensation()
+#define BUS_INPUT 0
+#define BUS_NOMINAL 2048 // 12-bit result at the bus voltage the tables are made for
+static bool _busCompensationEnabled = false;
+
+static void supervisionTask(void *context)
+{
+  // after a latched shutdown the chopper refuses to start until the reset
+  if(MkrSineChopperTcc.isShutdownLatched()) return;
+  
+  // the outputs stay off after a trip until the next supervision
+  if(MkrSineChopperTcc.isTripped()) {
+    expect0(MkrSineChopperTcc.recoverFromTrip());
+  } else if(!_ramp.isRunning()) {
+    expect0(_ramp.start());
+  }
+}
+
+// binary status frame, host side: HostTools/TelemetryRecorder
+#define TELEMETRY_PERIOD_MICROS 1000000L
+static void telemetryTask(void *context)
+{
+  static uint32_t n = 0;
+  struct TelemetryCounters counters;
+  counters.loopCount = ++n;
+  counters.cycleEnds = _numCycleEnds;
+  counters.droppedFrames = telemetryDroppedFrames();
+  expect0(telemetryRecord(TELEMETRY_COUNTERS, &counters, sizeof(counters)));
+  MkrSineChopperTcc.sendTelemetry();
+  if(MkrAdcScan.isRunning()) sendScanSamples();
+  telemetryFlush();
+}
+
+static bool _restoredFromStore = false;
+
+// runs right after reset before pins, ADC and USB are initialized
+void setupEarly()
+{
   // initialize ASF core including event system
   system_init();
   
-  restartChopper();
+  // resume the last saved operating point right away
+  MkrSineChopperTcc.setIsrSafeCycleEndCallback(atCycleEndIsrSafe);
+  _restoredFromStore = (MkrSineChopperTcc.startFromStore(atCycleEndCallback) == 0);
 }
 
-// the loop function runs over and over again forever
-void loop() 
+// fed by every pass of loop(), which sleeps 1s at most, see MkrSafety.h
+#define WATCHDOG_MILLIS 4000
+
+// the setup function runs once when you press reset or power the board
+void setup() 
 {
-  static int reset_counter = 1;
-  blink(reset_counter, 200);
-  delay(1000);
-  
-  static int n = 0;  
-  Serial.print(++n);
-  Serial.print(": cycleEnds=");
-  Serial.print(_numCycleEnds);
-  Serial.print(" ");
-  MkrSineChopperTcc.printValues();
-  Serial.println("");
+  SerialUSB.begin(115200);
+  expect0(MkrSafety.begin(WATCHDOG_MILLIS));
   
-  if(++reset_counter > 3) {
+  if(!_restoredFromStore) {
+    delay(1000); // let USB setup finish racing interrupts
     restartChopper();
-    reset_counter = 1;
   }
+  
+  pinMode(LED_BUILTIN, OUTPUT);
+  _blinkTask = MkrScheduler.addTask(blinkTask, 0, "blink");
+  _telemetryTask = MkrScheduler.addTask(telemetryTask, 0, "telemetry");
+  _supervisionTask = MkrScheduler.addTask(supervisionTask, 0, "supervision");
+  expect0(MkrSequencer.begin());
+  expect0(MkrScheduler.runIn(_blinkTask, 0));
+  expect0(MkrScheduler.runEvery(_telemetryTask, TELEMETRY_PERIOD_MICROS, TELEMETRY_PERIOD_MICROS));
+}
+
+// the loop function runs over and over again forever, everything periodic
+// is a task of MkrScheduler, which sleeps until the next task or interrupt
+void loop() 
+{
+  static bool bootReported = false;
+  if(!bootReported && SerialUSB) {
+    bootPhaseEnd(BOOT_PHASE_USB_OPEN);
+    printBootPhases();
+    bootReported = true;
+  }
+  
+  // single-character commands from the host
+  switch(SerialUSB.available() > 0 ? SerialUSB.read() : -1) {
+    case 'T': // host side: HostTools/CdcThroughput
+      runCdcThroughputTest(1024L * 1024L);
+      break;
+    case 'M': // metrics since the last 'M'
+      printMetrics(true);
+      break;
+    case 'D': // host side: HostTools/TraceDump
+      dumpTrace();
+      traceResume();
+      break;
+    case 'P': // formatting cycle counts
+      runPrintBenchmark();
+      break;
+    case 'A': // toggles the ADC scan, samples go out with the telemetry
+      if(MkrAdcScan.isRunning()) {
+        if(MkrAdcScan.stop() != 0) Serial.print("scan: feeds the trip\r\n");
+      } else if(startScan() != 0) {
+        Serial.print("scan: ADC in use\r\n");
+      }
+      break;
+    case 'S': // task statistics since the last 'S'
+      printTaskStatistics(true);
+      break;
+    case 'O': // toggles the over-current trip, scanning if needed
+      if(!_overCurrentTripEnabled && startScan() != 0) {
+        Serial.print("trip: ADC in use\r\n");
+        break;
+      }
+      _overCurrentTripEnabled = !_overCurrentTripEnabled;
+      if(_overCurrentTripEnabled) {
+        expect0(MkrAdcScan.setWindowAbove(OVER_CURRENT_THRESHOLD));
+      } else {
+        MkrAdcScan.clearWindow();
+      }
+      expect0(MkrSineChopperTcc.setOverCurrentTrip(_overCurrentTripEnabled, OVER_CURRENT_BLANKING_CYCLES));
+      break;
+    case 'B': // toggles the bus ripple compensation, only while not scanning
+      if(MkrSineChopperTcc.setBusCompensation(BUS_INPUT, _busCompensationEnabled ? 0 : BUS_NOMINAL) == 0) {
+        _busCompensationEnabled = !_busCompensationEnabled;
+      }
+      PRINT_FORMAT(Serial, "busCompensation={}\r\n", _busCompensationEnabled ? 1 : 0);
+      break;
+    case 'X': // shutdown drill, the supervision ramps the chopper up again
+      MkrSafety.shutdown(SHUTDOWN_DRILL);
+      MkrSineChopperTcc.stop();
+      PRINT_FORMAT(Serial, "shutdownCycles={}\r\n", MkrSafety.worstShutdownCycles());
+      break;
+  }
+  
+  MkrSafety.feedWatchdog();
+  MkrScheduler.dispatch();
 }
 
 